@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <ecs/util/alloc_tracker.hpp>
+
+namespace Bench
+{
+
+// Calls to the global operator new of the whole executable, from any thread
+inline std::atomic<std::uint64_t> Allocations { 0 };
+
+// Keeps the optimizer from removing the work of a benchmark
+template<class T>
+inline auto DoNotOptimize(T&& value) -> void
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result_t
+{
+    std::string   name   {  };
+    std::size_t   ops    {  };
+    double        ns     {  };
+    std::uint64_t allocs {  };
+
+    constexpr auto NsPerOp() const -> double
+    {
+        return ops ? ns / static_cast<double>(ops) : 0.0;
+    }
+
+    constexpr auto OpsPerSec() const -> double
+    {
+        return ns > 0.0 ? static_cast<double>(ops) * 1e9 / ns : 0.0;
+    }
+
+    constexpr auto AllocsPerOp() const -> double
+    {
+        return ops ? static_cast<double>(allocs) / static_cast<double>(ops)
+                   : 0.0;
+    }
+};
+
+// Everything printed so far, for WriteJson
+inline std::vector<Result_t> Results {  };
+
+template<class Callable_t>
+auto Measure(std::string name, std::size_t ops, Callable_t&& callable)
+-> Result_t
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto allocs { Allocations.load(std::memory_order_relaxed) };
+    auto start { Clock::now() };
+    callable();
+    auto end   { Clock::now() };
+
+    std::chrono::duration<double, std::nano> elapsed { end - start };
+    return { std::move(name), ops, elapsed.count(),
+             Allocations.load(std::memory_order_relaxed) - allocs };
+}
+
+inline auto Print(const Result_t& res) -> void
+{
+    std::printf("%-48s %12zu ops %10.2f ns/op %14.0f ops/s %10.3f allocs/op\n",
+                res.name.c_str(), res.ops, res.NsPerOp(), res.OpsPerSec(),
+                res.AllocsPerOp());
+    Results.push_back(res);
+}
+
+// Takes "--json <file>" out of the arguments, so the rest are parsed as
+// before, and gives the file or nullptr
+inline auto TakeJsonPath(int& argc, char* argv[]) -> const char*
+{
+    for (int i { 1 }; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            const char* path { argv[i + 1] };
+            for (int j { i }; j + 2 <= argc; ++j) {
+                argv[j] = argv[j + 2];
+            }
+            argc -= 2;
+            return path;
+        }
+    }
+    return nullptr;
+}
+
+// One object for each result printed, in the order they were printed
+inline auto WriteJson(const char* path) -> bool
+{
+    FILE* file { std::fopen(path, "w") };
+    if (!file) {
+        std::fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    std::fprintf(file, "[\n");
+    for (std::size_t i { 0 }; i < Results.size(); ++i) {
+        const auto& res { Results[i] };
+        std::fprintf(file, "  { \"name\": \"");
+        for (const char c : res.name) {
+            if (c == '"' || c == '\\') {
+                std::fputc('\\', file);
+            }
+            std::fputc(c, file);
+        }
+        std::fprintf(file, "\", \"ops\": %zu, \"ns\": %.0f, \"ns_per_op\": %.3f,"
+                           " \"ops_per_sec\": %.0f, \"allocs\": %llu,"
+                           " \"allocs_per_op\": %.4f }%s\n",
+                     res.ops, res.ns, res.NsPerOp(), res.OpsPerSec(),
+                     static_cast<unsigned long long>(res.allocs),
+                     res.AllocsPerOp(), i + 1 < Results.size() ? "," : "");
+    }
+    std::fprintf(file, "]\n");
+    return std::fclose(file) == 0;
+}
+
+} // namespace Bench
+
+// Every bench is one source, so the global allocation functions are
+// replaced here to count the allocations, they feed the tracker of
+// ecs/util/alloc_tracker.hpp too when it's built in. The aligned ones round
+// the size up as aligned_alloc wants
+
+inline auto BenchAllocate(std::size_t size) -> void*
+{
+    Bench::Allocations.fetch_add(1, std::memory_order_relaxed);
+    ECS_ALLOC_TRACK(size);
+    if (auto* ptr { std::malloc(size ? size : 1) }) {
+        return ptr;
+    }
+    std::abort();
+}
+
+inline auto BenchAllocate(std::size_t size, std::align_val_t align) -> void*
+{
+    Bench::Allocations.fetch_add(1, std::memory_order_relaxed);
+    ECS_ALLOC_TRACK(size);
+    const auto al { static_cast<std::size_t>(align) };
+    const auto rounded { (size ? size + al - 1 : al) / al * al };
+    if (auto* ptr { std::aligned_alloc(al, rounded) }) {
+        return ptr;
+    }
+    std::abort();
+}
+
+auto operator new(std::size_t size) -> void* { return BenchAllocate(size); }
+auto operator new[](std::size_t size) -> void* { return BenchAllocate(size); }
+
+auto operator new(std::size_t size, std::align_val_t align) -> void*
+{
+    return BenchAllocate(size, align);
+}
+
+auto operator new[](std::size_t size, std::align_val_t align) -> void*
+{
+    return BenchAllocate(size, align);
+}
+
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void* ptr, std::size_t) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr, std::size_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::align_val_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr, std::align_val_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+-> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+-> void
+{
+    std::free(ptr);
+}
@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ecs/man/entity_manager.hpp>
+#include <game/sys/collider.hpp>
+#include <game/sys/physics.hpp>
+#include <game/sys/sleep.hpp>
+#include <game/util/colliders.hpp>
+
+#include "bench.hpp"
+
+// ColliderSystem_t with blade sized boxes at the same density for every
+// count, the world grows with the number of colliders. The bodies move
+// between the frames but only the collider update is timed. The players
+// runs give one collider in PlayerEvery the tree of the player, that scene
+// is bound by the narrowphase and runs on one thread and on all of them. The
+// level runs have all but one collider in LevelBladeEvery standing still as
+// platforms, flagged static, not flagged or put to sleep by SleepSystem_t
+// between the frames, the mixed ones have half of each. Before the timings
+// the three broadphases run the same scenes side by side and must find the
+// same contacts in the same order every frame
+// usage: collider [cell_size] [frames]
+
+using BenchEntityManager_t = ECS::EntityManager_t<PhysicsComponent_t,
+                                                  ColliderComponent_t>;
+using Broadphase_t = ColliderSystem_t::Broadphase_t;
+
+// Pixels of world for each collider
+constexpr unsigned AreaPerCollider { 4096 };
+
+constexpr std::size_t PlayerEvery     { 16 };
+constexpr std::size_t LevelBladeEvery { 10 };
+
+enum class Scene_t
+{
+    Blades,
+    Players,
+    Level,
+    StaticLevel,
+    AsleepLevel,
+    MixedLevel
+};
+
+constexpr auto SleepsBetweenFrames(Scene_t scene) -> bool
+{
+    return scene == Scene_t::AsleepLevel || scene == Scene_t::MixedLevel;
+}
+
+// Returns the side of the world
+auto FillScene(BenchEntityManager_t& ent_man, std::size_t n_ents,
+               Scene_t scene)
+-> unsigned
+{
+    const auto side
+    {
+        static_cast<unsigned>(std::sqrt(double(n_ents) * AreaPerCollider))
+    };
+
+    std::mt19937 rng { 1234 };
+    for (std::size_t i { 0 }; i < n_ents; ++i) {
+        auto& ent { ent_man.CreateEntity() };
+        const auto px { static_cast<int>(rng() % side) };
+        const auto py { static_cast<int>(rng() % side) };
+        const bool level    { scene == Scene_t::Level
+                              || scene == Scene_t::StaticLevel
+                              || SleepsBetweenFrames(scene) };
+        const bool platform { level && i % LevelBladeEvery != 0 };
+        ent_man.CreateRequieredComponent<PhysicsComponent_t>
+        (ent, VecInt{ px, py }, platform ? VecInt{  } : VecInt{ 5, 7 });
+        auto& col
+        {
+            ent_man.CreateRequieredComponent<ColliderComponent_t>(ent)
+        };
+        col.BoxRoot.box = { 0, 16, 0, 16 };
+        col.mask = i % 2 ? ColliderComponent_t::LBLADES
+                         : ColliderComponent_t::LPLATFORM;
+        if (scene == Scene_t::Players && i % PlayerEvery == 0) {
+            col.BoxRoot.box  = BoxFromSize(0, 686, 0, 546, 5.0f);
+            col.BoxRoot.root = PlayerBoxNodes(5.0f);
+            col.mask = ColliderComponent_t::LNONE;
+        }
+        if (platform) {
+            col.mask = ColliderComponent_t::LPLATFORM;
+            col.is_static = scene == Scene_t::StaticLevel
+                            || (scene == Scene_t::MixedLevel
+                                && i % (2 * LevelBladeEvery) == 1);
+        } else if (level) {
+            col.mask = ColliderComponent_t::LBLADES;
+        }
+    }
+    return side;
+}
+
+auto RunColliderBench(const std::string& tag,
+                      Broadphase_t broadphase,
+                      unsigned cell_size,
+                      std::size_t n_ents,
+                      std::size_t frames,
+                      Scene_t scene = Scene_t::Blades,
+                      ECS::ThreadPool_t* pool = nullptr)
+-> void
+{
+    BenchEntityManager_t ent_man {  };
+    const auto side { FillScene(ent_man, n_ents, scene) };
+
+    ColliderSystem_t col_sys { side, side, broadphase, cell_size };
+    col_sys.pool = pool;
+    PhysicsSystem_t  phy_sys {  };
+    SleepSystem_t    slp_sys { col_sys.GetContacts(), 1 };
+    double ns {  };
+    for (std::size_t f { 0 }; f < frames; ++f) {
+        phy_sys.Update(ent_man);
+        ns += Bench::Measure("", 0, [&] { col_sys.Update(ent_man); }).ns;
+        if (SleepsBetweenFrames(scene)) {
+            slp_sys.Update(ent_man);
+            ent_man.FlushCommandBuffer();
+        }
+    }
+    Bench::Print({ "collider/" + tag + "/" + std::to_string(n_ents),
+                   n_ents * frames, ns });
+}
+
+auto SameContacts(const ContactBuffer_t& cb1, const ContactBuffer_t& cb2)
+-> bool
+{
+    auto same {
+        [](const Contact_t& c1, const Contact_t& c2) {
+            return c1.entityA == c2.entityA && c1.entityB == c2.entityB
+                && c1.leafA   == c2.leafA   && c1.leafB   == c2.leafB;
+        }
+    };
+    return std::equal(cb1.contacts.begin(), cb1.contacts.end(),
+                      cb2.contacts.begin(), cb2.contacts.end(), same)
+        && cb1.touched == cb2.touched;
+}
+
+// The flags of the leaves, asleep colliders keep the ones they had
+auto SameCollidedFlags(BenchEntityManager_t& man1, BenchEntityManager_t& man2)
+-> bool
+{
+    const auto& ents1 { man1.GetEntities() };
+    const auto& ents2 { man2.GetEntities() };
+    for (std::size_t i { 0 }; i < ents1.size() && i < ents2.size(); ++i) {
+        if (!ents1[i].IsAlive() || !ents2[i].IsAlive()
+            || !man1.HasComponents<ColliderComponent_t>(ents1[i])) {
+            continue;
+        }
+        const auto& tree1 {
+            man1.GetRequieredComponent<ColliderComponent_t>(ents1[i]).BoxTree
+        };
+        const auto& tree2 {
+            man2.GetRequieredComponent<ColliderComponent_t>(ents2[i]).BoxTree
+        };
+        if (tree1.collided != tree2.collided) {
+            return false;
+        }
+    }
+    return ents1.size() == ents2.size();
+}
+
+// The worlds of the three broadphases start the same and stay the same as
+// long as their contacts do, the sleeps depend on them
+auto CheckBroadphases(const std::string& tag,
+                      unsigned cell_size,
+                      std::size_t n_ents,
+                      std::size_t frames,
+                      Scene_t scene,
+                      ECS::ThreadPool_t* pool = nullptr)
+-> bool
+{
+    constexpr Broadphase_t broadphases[]
+    {
+        Broadphase_t::BruteForce, Broadphase_t::Grid,
+        Broadphase_t::SweepAndPrune
+    };
+    constexpr std::size_t n_worlds { std::size(broadphases) };
+
+    BenchEntityManager_t ent_mans[n_worlds];
+    std::vector<ColliderSystem_t> col_syss {  };
+    std::vector<SleepSystem_t>    slp_syss {  };
+    col_syss.reserve(n_worlds);
+    slp_syss.reserve(n_worlds);
+    for (std::size_t w { 0 }; w < n_worlds; ++w) {
+        const auto side { FillScene(ent_mans[w], n_ents, scene) };
+        col_syss.emplace_back(side, side, broadphases[w], cell_size);
+        col_syss.back().pool = pool;
+        slp_syss.emplace_back(col_syss.back().GetContacts(), 1);
+    }
+
+    PhysicsSystem_t phy_sys {  };
+    std::size_t contacts {  };
+    for (std::size_t f { 0 }; f < frames; ++f) {
+        for (std::size_t w { 0 }; w < n_worlds; ++w) {
+            phy_sys.Update(ent_mans[w]);
+            col_syss[w].Update(ent_mans[w]);
+        }
+        const auto& expected { col_syss[0].GetContacts() };
+        for (std::size_t w { 1 }; w < n_worlds; ++w) {
+            if (!SameContacts(expected, col_syss[w].GetContacts())
+                || !SameCollidedFlags(ent_mans[0], ent_mans[w])) {
+                std::printf("collider/check/%s/%zu: broadphase %zu differs"
+                            " from the brute force loop at frame %zu\n",
+                            tag.c_str(), n_ents, w, f);
+                return false;
+            }
+        }
+        contacts += expected.contacts.size();
+        if (SleepsBetweenFrames(scene)) {
+            for (std::size_t w { 0 }; w < n_worlds; ++w) {
+                slp_syss[w].Update(ent_mans[w]);
+                ent_mans[w].FlushCommandBuffer();
+            }
+        }
+        // Puts the platforms to sleep with the flags of their first
+        // contacts, the ones that aren't hit again must keep them
+        if (scene == Scene_t::MixedLevel && f == 0) {
+            for (auto& ent_man : ent_mans) {
+                for (const auto& ent : ent_man.GetEntities()) {
+                    const auto& col {
+                        ent_man.GetRequieredComponent<ColliderComponent_t>(ent)
+                    };
+                    if (col.mask == ColliderComponent_t::LPLATFORM
+                        && !col.is_static) {
+                        ent_man.Sleep(ent);
+                    }
+                }
+            }
+        }
+    }
+    std::printf("collider/check/%s/%zu: %zu contacts in %zu frames, same"
+                " for every broadphase\n",
+                tag.c_str(), n_ents, contacts, frames);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned cell_size
+    {
+        argc > 1 ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10))
+                 : 64
+    };
+    const std::size_t frames
+    {
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10
+    };
+
+    auto& pool { ECS::ThreadPool_t::GetDefault() };
+    const bool same {
+        CheckBroadphases("blades", cell_size, 1000, 20, Scene_t::Blades)
+        && CheckBroadphases("players", cell_size, 1000, 20,
+                            Scene_t::Players, &pool)
+        && CheckBroadphases("static_level", cell_size, 1000, 20,
+                            Scene_t::StaticLevel)
+        && CheckBroadphases("asleep_level", cell_size, 1000, 20,
+                            Scene_t::AsleepLevel)
+        && CheckBroadphases("mixed_level", cell_size, 1000, 20,
+                            Scene_t::MixedLevel, &pool)
+    };
+    if (!same) {
+        return 1;
+    }
+
+    // The brute force loop is quadratic, past 10k it takes minutes
+    for (const std::size_t n_ents : { 1000, 10000 }) {
+        RunColliderBench("brute_force", Broadphase_t::BruteForce, cell_size,
+                         n_ents, frames);
+    }
+    for (const std::size_t n_ents : { 1000, 10000, 100000 }) {
+        RunColliderBench("grid", Broadphase_t::Grid, cell_size,
+                         n_ents, frames);
+    }
+    for (const std::size_t n_ents : { 1000, 10000, 100000 }) {
+        RunColliderBench("sweep_and_prune", Broadphase_t::SweepAndPrune,
+                         cell_size, n_ents, frames);
+    }
+
+    const auto threads { std::to_string(pool.GetThreadCount()) };
+    for (const std::size_t n_ents : { 10000, 100000 }) {
+        RunColliderBench("players/grid/1_thread", Broadphase_t::Grid,
+                         cell_size, n_ents, frames, Scene_t::Players);
+        RunColliderBench("players/grid/" + threads + "_threads",
+                         Broadphase_t::Grid, cell_size, n_ents, frames,
+                         Scene_t::Players, &pool);
+    }
+
+    for (const std::size_t n_ents : { 10000, 100000 }) {
+        RunColliderBench("level/grid/all_dynamic", Broadphase_t::Grid,
+                         cell_size, n_ents, frames, Scene_t::Level);
+        RunColliderBench("level/grid/static_platforms", Broadphase_t::Grid,
+                         cell_size, n_ents, frames, Scene_t::StaticLevel);
+        RunColliderBench("level/sweep_and_prune/all_dynamic",
+                         Broadphase_t::SweepAndPrune, cell_size, n_ents,
+                         frames, Scene_t::Level);
+        RunColliderBench("level/sweep_and_prune/static_platforms",
+                         Broadphase_t::SweepAndPrune, cell_size, n_ents,
+                         frames, Scene_t::StaticLevel);
+        RunColliderBench("level/grid/asleep_platforms", Broadphase_t::Grid,
+                         cell_size, n_ents, frames, Scene_t::AsleepLevel);
+        RunColliderBench("level/sweep_and_prune/asleep_platforms",
+                         Broadphase_t::SweepAndPrune, cell_size, n_ents,
+                         frames, Scene_t::AsleepLevel);
+    }
+
+    return 0;
+}
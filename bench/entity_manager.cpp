@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ecs/man/entity_manager.hpp>
+
+#include "bench.hpp"
+
+// Each public operation of the entity manager on its own, for every storage
+// policy and 1k, 100k and 1M entities. The smaller counts repeat the run on a
+// new manager until they reach as many operations as 1M, only the operation
+// is timed. Lookups and removals go in a shuffled order so they don't just
+// walk the pools. Before the timings every storage must take a component
+// attached twice as one row
+//
+// usage: entity_manager [--json file] [entities...]
+
+template<std::size_t I>
+struct BenchComponent_t
+{
+    std::uint64_t value { I };
+};
+
+template<class StoragePolicy_t>
+using BenchEntityManager_t = ECS::BasicEntityManager_t<StoragePolicy_t,
+                                                       BenchComponent_t<0>,
+                                                       BenchComponent_t<1>,
+                                                       BenchComponent_t<2>,
+                                                       BenchComponent_t<3>>;
+
+template<std::size_t... I>
+auto BenchComponents(std::index_sequence<I...>)
+-> TMP::TypeList_t<BenchComponent_t<I>...>;
+
+// The first N bench components
+template<std::size_t N>
+using FirstComponents_t = decltype(BenchComponents(std::make_index_sequence<N>{}));
+
+template<std::size_t I>
+auto Value(const BenchComponent_t<I>& cmp) -> std::uint64_t
+{
+    return cmp.value;
+}
+
+template<class Entity_t>
+auto Value(const Entity_t&) -> std::uint64_t { return 0; }
+
+template<class EntMan_t, class... Cmps_t>
+auto CreateComponents(EntMan_t& ent_man, typename EntMan_t::OwnEntity_t& ent,
+                      TMP::TypeList_t<Cmps_t...>) -> void
+{
+    ent_man.template CreateRequieredComponents<Cmps_t...>
+        (ent, ((void)sizeof(Cmps_t), ECS::MakeArgs())...);
+}
+
+// All the entities have the first three components, the even ones the
+// fourth too
+template<class EntMan_t>
+auto MakePopulated(std::size_t n_ents) -> std::unique_ptr<EntMan_t>
+{
+    auto ent_man { std::make_unique<EntMan_t>() };
+    ent_man->ReserveEntities(n_ents);
+    for (std::size_t i { 0 }; i < n_ents; ++i) {
+        auto& ent { ent_man->CreateEntity() };
+        if (i % 2 == 0) {
+            CreateComponents(*ent_man, ent, FirstComponents_t<4>{});
+        } else {
+            CreateComponents(*ent_man, ent, FirstComponents_t<3>{});
+        }
+    }
+    return ent_man;
+}
+
+// Setup untimed and op timed, reps times, printed as one result
+template<class Setup_t, class Op_t>
+auto Run(const std::string& name, std::size_t reps, std::size_t ops,
+         Setup_t&& setup, Op_t&& op) -> void
+{
+    Bench::Result_t total { name, 0, 0.0, 0 };
+    for (std::size_t rep { 0 }; rep < reps; ++rep) {
+        auto ent_man { setup() };
+        const auto res { Bench::Measure(name, ops, [&] { op(*ent_man); }) };
+        total.ops    += res.ops;
+        total.ns     += res.ns;
+        total.allocs += res.allocs;
+    }
+    Bench::Print(total);
+}
+
+template<class EntMan_t, std::size_t N>
+auto RunCreateComponents(const std::string& tag, std::size_t reps,
+                         std::size_t n_ents) -> void
+{
+    Run(tag + "/create_components<" + std::to_string(N) + ">", reps, n_ents,
+        [n_ents] {
+            auto ent_man { std::make_unique<EntMan_t>() };
+            ent_man->ReserveEntities(n_ents);
+            for (std::size_t i { 0 }; i < n_ents; ++i) {
+                ent_man->CreateEntity();
+            }
+            return ent_man;
+        },
+        [n_ents](EntMan_t& ent_man) {
+            for (std::size_t i { 0 }; i < n_ents; ++i) {
+                CreateComponents(ent_man, ent_man.GetEntityByID(i),
+                                 FirstComponents_t<N>{});
+            }
+        });
+}
+
+template<class EntMan_t, std::size_t N>
+auto RunForEach(const std::string& tag, std::size_t reps,
+                std::size_t n_ents) -> void
+{
+    const auto matched { N == 4 ? (n_ents + 1) / 2 : n_ents };
+    Run(tag + "/foreach<" + std::to_string(N) + ">", reps, matched,
+        [n_ents] { return MakePopulated<EntMan_t>(n_ents); },
+        [](EntMan_t& ent_man) {
+            std::uint64_t sum { 0 };
+            ent_man.template DoForEachComponentType<FirstComponents_t<N>>(
+                [&sum](auto&... args) { ((sum += Value(args)), ...); });
+            Bench::DoNotOptimize(sum);
+        });
+}
+
+// The second attach of a component, on its own or with others, assigns over
+// the first one. The entity is visited once with the last value and its
+// removal leaves no row behind
+template<class StoragePolicy_t>
+auto CheckDuplicateAttach(const std::string& storage) -> bool
+{
+    using EntMan_t = BenchEntityManager_t<StoragePolicy_t>;
+    using Cmp0_t   = BenchComponent_t<0>;
+    using Cmp1_t   = BenchComponent_t<1>;
+
+    EntMan_t ent_man {  };
+    auto& ent { ent_man.CreateEntity() };
+    ent_man.template CreateRequieredComponent<Cmp0_t>(ent, 10u);
+    ent_man.template CreateRequieredComponent<Cmp0_t>(ent, 20u);
+    ent_man.template CreateRequieredComponents<Cmp0_t, Cmp1_t>
+        (ent, ECS::MakeArgs(30u), ECS::MakeArgs(40u));
+
+    auto visits {
+        [&ent_man] {
+            std::size_t n { 0 };
+            std::uint64_t sum { 0 };
+            ent_man.template DoForEachComponentType<FirstComponents_t<1>>(
+                [&n, &sum](auto& cmp, auto&) { ++n; sum += cmp.value; });
+            return std::make_pair(n, sum);
+        }
+    };
+    const auto attached { visits() };
+    ent_man.RemoveEntity(ent);
+    const auto removed { visits() };
+
+    const bool ok { attached == std::make_pair(std::size_t{ 1 },
+                                               std::uint64_t{ 30 })
+                    && removed.first == 0 };
+    if (!ok) {
+        std::printf("entity_manager/check/%s: a component attached twice"
+                    " left %zu rows, %zu after the removal\n",
+                    storage.c_str(), attached.first, removed.first);
+    }
+    return ok;
+}
+
+template<class StoragePolicy_t>
+auto RunEntityManagerBench(const std::string& storage,
+                           std::size_t n_ents) -> void
+{
+    using EntMan_t = BenchEntityManager_t<StoragePolicy_t>;
+
+    const auto tag  { storage + "/" + std::to_string(n_ents) };
+    const auto reps { std::max<std::size_t>(1, 1000000 / n_ents) };
+
+    std::vector<std::size_t> order(n_ents);
+    std::iota(order.begin(), order.end(), std::size_t{ 0 });
+    std::shuffle(order.begin(), order.end(), std::mt19937_64{ 42 });
+
+    Run(tag + "/create_entity", reps, n_ents,
+        [] { return std::make_unique<EntMan_t>(); },
+        [n_ents](EntMan_t& ent_man) {
+            for (std::size_t i { 0 }; i < n_ents; ++i) {
+                Bench::DoNotOptimize(ent_man.CreateEntity());
+            }
+        });
+
+    RunCreateComponents<EntMan_t, 1>(tag, reps, n_ents);
+    RunCreateComponents<EntMan_t, 2>(tag, reps, n_ents);
+    RunCreateComponents<EntMan_t, 3>(tag, reps, n_ents);
+    RunCreateComponents<EntMan_t, 4>(tag, reps, n_ents);
+
+    Run(tag + "/get_requiered", reps, n_ents,
+        [n_ents] { return MakePopulated<EntMan_t>(n_ents); },
+        [&order](EntMan_t& ent_man) {
+            std::uint64_t sum { 0 };
+            for (const auto i : order) {
+                sum += ent_man.template
+                       GetRequieredComponent<BenchComponent_t<1>>
+                       (ent_man.GetEntityByID(i)).value;
+            }
+            Bench::DoNotOptimize(sum);
+        });
+
+    // Half of them have it, so both ways are taken
+    Run(tag + "/get_optional", reps, n_ents,
+        [n_ents] { return MakePopulated<EntMan_t>(n_ents); },
+        [&order](EntMan_t& ent_man) {
+            std::uint64_t sum { 0 };
+            for (const auto i : order) {
+                auto opt
+                {
+                    ent_man.template GetOptionalComponent<BenchComponent_t<3>>
+                    (ent_man.GetEntityByID(i))
+                };
+                if (opt) {
+                    sum += opt->get().value;
+                }
+            }
+            Bench::DoNotOptimize(sum);
+        });
+
+    RunForEach<EntMan_t, 1>(tag, reps, n_ents);
+    RunForEach<EntMan_t, 2>(tag, reps, n_ents);
+    RunForEach<EntMan_t, 3>(tag, reps, n_ents);
+    RunForEach<EntMan_t, 4>(tag, reps, n_ents);
+
+    Run(tag + "/remove_entity", reps, n_ents,
+        [n_ents] { return MakePopulated<EntMan_t>(n_ents); },
+        [&order](EntMan_t& ent_man) {
+            for (const auto i : order) {
+                ent_man.RemoveEntity(ent_man.GetEntityByID(i));
+            }
+        });
+}
+
+int main(int argc, char* argv[])
+{
+    const char* json { Bench::TakeJsonPath(argc, argv) };
+
+    std::vector<std::size_t> sizes { 1000, 100000, 1000000 };
+    if (argc > 1) {
+        sizes.clear();
+        for (int i { 1 }; i < argc; ++i) {
+            sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+    }
+
+    if (!CheckDuplicateAttach<ECS::EntityMapStorage_t>("map")
+        || !CheckDuplicateAttach<ECS::SparseSetStorage_t>("sparse_set")
+        || !CheckDuplicateAttach<ECS::ArchetypeStorage_t>("archetype")) {
+        return 1;
+    }
+
+    for (const auto n_ents : sizes) {
+        RunEntityManagerBench<ECS::EntityMapStorage_t>("map", n_ents);
+        RunEntityManagerBench<ECS::SparseSetStorage_t>("sparse_set", n_ents);
+        RunEntityManagerBench<ECS::ArchetypeStorage_t>("archetype", n_ents);
+    }
+
+    if (json && !Bench::WriteJson(json)) {
+        return 1;
+    }
+    return 0;
+}
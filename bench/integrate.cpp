@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <string>
+
+#include <ecs/man/entity_manager.hpp>
+#include <ecs/util/simd.hpp>
+#include <game/cmp/physics.hpp>
+#include <tmp/type_list.hpp>
+
+#include "bench.hpp"
+
+// The physics integrate loop through the per entity lambda against the
+// packed add kernel at every instruction set this CPU has
+// usage: integrate [frames]
+
+using BenchEntityManager_t = ECS::EntityManager_t<PhysicsComponent_t>;
+
+auto RunIntegrateBench(std::size_t n_ents, std::size_t frames) -> void
+{
+    BenchEntityManager_t ent_man {  };
+    ent_man.ReserveEntities(n_ents);
+    ent_man.ReserveComponents<PhysicsComponent_t>(n_ents);
+    for (std::size_t i { 0 }; i < n_ents; ++i) {
+        auto& ent { ent_man.CreateEntity() };
+        const auto val { static_cast<int>(i % 640) };
+        ent_man.CreateRequieredComponent<PhysicsComponent_t>
+        (ent, VecInt{ val, val }, VecInt{ 1, -1 });
+    }
+
+    const auto tag { std::to_string(n_ents) };
+    // One thread, so the numbers are the ones of the kernels
+    ECS::ThreadPool_t pool { 1 };
+
+    Bench::Print(Bench::Measure("integrate/" + tag + "/lambda",
+                                n_ents * frames, [&] {
+        for (std::size_t f { 0 }; f < frames; ++f) {
+            ent_man.ParallelForEach<TMP::TypeList_t<PhysicsComponent_t>>(
+                [](auto&& phy, auto&) {
+                    phy.pos += phy.vel;
+                }, BenchEntityManager_t::DefaultGrain, pool);
+        }
+    }));
+
+    constexpr ECS::SimdLevel_t levels[]
+    {
+        ECS::SimdLevel_t::Scalar, ECS::SimdLevel_t::SSE2,
+        ECS::SimdLevel_t::AVX2
+    };
+    for (const auto level : levels) {
+        if (level > ECS::GetSimdLevel()) {
+            break;
+        }
+        const std::string name
+        {
+            "integrate/" + tag + "/" + ECS::SimdLevelName(level)
+        };
+        Bench::Print(Bench::Measure(name, n_ents * frames, [&] {
+            for (std::size_t f { 0 }; f < frames; ++f) {
+                ent_man.ParallelForEachBatch<PhysicsComponent_t>(
+                    [level](auto& phys, std::size_t begin, std::size_t end) {
+                        auto* pos { phys.template GetField<0>().data() };
+                        auto* vel { phys.template GetField<1>().data() };
+                        ECS::AddInPlace(level,
+                                        &pos[begin].x, &vel[begin].x,
+                                        2 * (end - begin));
+                    }, BenchEntityManager_t::DefaultGrain, pool);
+            }
+        }));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t frames
+    {
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50
+    };
+
+    for (const std::size_t n_ents : { 10000, 100000, 1000000 }) {
+        RunIntegrateBench(n_ents, frames);
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <ecs/util/simd.hpp>
+#include <game/sys/collider.hpp>
+#include <game/util/colliders.hpp>
+
+#include "bench.hpp"
+
+// A collider tree against itself at every offset of a grid around it, the
+// scalar skip walk against the child mask descent at every instruction set
+// this CPU has. The tree of the player has at most 6 children in a node, the
+// tile trees are a root over a square of leaves, as a platform made of tiles
+// usage: narrowphase [rounds]
+
+// Offsets of the second player, in pixels, both axes
+constexpr int OffsetRange { 150 };
+constexpr int OffsetStep  { 5 };
+
+auto MakePlayerTree() -> BoundingBoxTree_t
+{
+    constexpr float sz { 5.0f };
+    BoundingBoxNode_t root {  };
+    root.box  = BoxFromSize(0, 686, 0, 546, sz);
+    root.root = PlayerBoxNodes(sz);
+
+    BoundingBoxTree_t tree {  };
+    tree.Build(root);
+    return tree;
+}
+
+// side * side tiles of 16 pixels under the root
+auto MakeTileTree(unsigned side) -> BoundingBoxTree_t
+{
+    constexpr unsigned tile { 16 };
+    BoundingBoxNode_t root {  };
+    root.box = { 0, side * tile - 1, 0, side * tile - 1 };
+    for (unsigned y { 0 }; y < side; ++y) {
+        for (unsigned x { 0 }; x < side; ++x) {
+            root.root.push_back({ {  }, { x * tile, (x + 1) * tile - 1,
+                                          y * tile, (y + 1) * tile - 1 } });
+        }
+    }
+
+    BoundingBoxTree_t tree {  };
+    tree.Build(root);
+    return tree;
+}
+
+template<class Check_t>
+auto RunNarrowphaseBench(const std::string& tag, std::size_t rounds,
+                         const BoundingBoxTree_t& tree, Check_t&& check)
+-> void
+{
+    auto bt1 { tree };
+    auto bt2 { tree };
+    VecInt pos1 { 1000, 1000 }, vel1 {  };
+    VecInt pos2 {  }, vel2 {  };
+    const PhysicsRef_t<VecInt> ph1 { pos1, vel1 };
+    const PhysicsRef_t<VecInt> ph2 { pos2, vel2 };
+
+    std::size_t ops { 0 };
+    std::size_t hits { 0 };
+    const auto res { Bench::Measure("", 0, [&] {
+        for (std::size_t r { 0 }; r < rounds; ++r) {
+            for (int dy { -OffsetRange }; dy <= OffsetRange; dy += OffsetStep) {
+                for (int dx { -OffsetRange }; dx <= OffsetRange;
+                     dx += OffsetStep) {
+                    pos2 = { pos1.x + dx, pos1.y + dy };
+                    bt1.ResetCollided();
+                    bt2.ResetCollided();
+                    check(bt1, bt2, ph1, ph2);
+                    hits += bt1.AnyLeafCollided();
+                    ++ops;
+                }
+            }
+        }
+    }) };
+    Bench::DoNotOptimize(hits);
+    Bench::Print({ "narrowphase/" + tag, ops, res.ns });
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t rounds
+    {
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200
+    };
+
+    const std::pair<std::string, BoundingBoxTree_t> trees[]
+    {
+        { "player",     MakePlayerTree()  },
+        { "tiles_3x3",  MakeTileTree(3)   },
+        { "tiles_4x4",  MakeTileTree(4)   },
+        { "tiles_6x6",  MakeTileTree(6)   },
+        { "tiles_8x8",  MakeTileTree(8)   }
+    };
+    constexpr ECS::SimdLevel_t levels[]
+    {
+        ECS::SimdLevel_t::Scalar, ECS::SimdLevel_t::SSE2,
+        ECS::SimdLevel_t::AVX2
+    };
+
+    ColliderSystem_t col_sys { 640, 480 };
+    ColliderSystem_t::NarrowphaseBatch_t batch {  };
+    for (const auto& [name, tree] : trees) {
+        RunNarrowphaseBench(name + "/scalar_walk", rounds, tree,
+            [&](auto& bt1, auto& bt2, auto& ph1, auto& ph2) {
+                col_sys.CheckBoundingBoxNodeCollisionScalar(bt1, bt2,
+                                                            ph1, ph2);
+            });
+        for (const auto level : levels) {
+            if (level > ECS::GetSimdLevel()) {
+                break;
+            }
+            col_sys.simd = level;
+            RunNarrowphaseBench(name + "/mask/" + ECS::SimdLevelName(level),
+                                rounds, tree,
+                [&](auto& bt1, auto& bt2, auto& ph1, auto& ph2) {
+                    col_sys.CheckBoundingBoxNodeCollisionMask(bt1, bt2,
+                                                              ph1, ph2,
+                                                              batch);
+                });
+        }
+    }
+
+    return 0;
+}
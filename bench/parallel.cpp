@@ -0,0 +1,69 @@
+#include <cstdlib>
+#include <string>
+
+#include <ecs/man/entity_manager.hpp>
+#include <game/cmp/physics.hpp>
+#include <game/cmp/health.hpp>
+#include <tmp/type_list.hpp>
+
+#include "bench.hpp"
+
+// Scaling of the physics integrate loop with the threads of the pool
+// usage: parallel [n_ents] [max_threads] [frames]
+
+using BenchEntityManager_t = ECS::EntityManager_t<PhysicsComponent_t,
+                                                  HealthComponent_t>;
+
+int main(int argc, char** argv)
+{
+    const std::size_t n_ents
+    {
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000
+    };
+    const std::size_t max_threads
+    {
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                 : ECS::ThreadPool_t::DefaultThreadCount()
+    };
+    const std::size_t frames
+    {
+        argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 20
+    };
+
+    BenchEntityManager_t ent_man {  };
+    ent_man.ReserveEntities(n_ents);
+    ent_man.ReserveComponents<PhysicsComponent_t>(n_ents);
+    for (std::size_t i { 0 }; i < n_ents; ++i) {
+        auto& ent { ent_man.CreateEntity() };
+        const auto val { static_cast<int>(i % 640) };
+        ent_man.CreateRequieredComponent<PhysicsComponent_t>
+        (ent, VecInt{ val, val }, VecInt{ 1, -1 });
+    }
+
+    double single_ns {  };
+    for (std::size_t threads { 1 }; threads <= max_threads; ++threads) {
+        ECS::ThreadPool_t pool { threads };
+
+        auto res
+        {
+            Bench::Measure("integrate/threads:" + std::to_string(threads),
+                           n_ents * frames, [&] {
+                for (std::size_t f { 0 }; f < frames; ++f) {
+                    ent_man.ParallelForEach
+                    <TMP::TypeList_t<PhysicsComponent_t>>(
+                        [](auto&& phy, auto&) {
+                            phy.pos += phy.vel;
+                        }, BenchEntityManager_t::DefaultGrain, pool);
+                }
+            })
+        };
+        Bench::Print(res);
+
+        if (threads == 1) {
+            single_ns = res.ns;
+        }
+        std::printf("%-48s %12.2fx\n", "  speedup", single_ns / res.ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <cstdlib>
+#include <string>
+
+#include <ecs/man/entity_manager.hpp>
+#include <game/cmp/physics.hpp>
+#include <tmp/type_list.hpp>
+
+#include "bench.hpp"
+
+// The same physics data stored as whole components and split in one array
+// for each field, PhysicsComponent_t opts in to the split layout
+// usage: soa [n_ents] [frames]
+
+struct PhysicsAoS_t
+{
+    VecInt pos {  };
+    VecInt vel {  };
+};
+
+using BenchEntityManager_t = ECS::EntityManager_t<PhysicsComponent_t,
+                                                  PhysicsAoS_t>;
+
+template<class Physics_t>
+auto RunLayoutBench(BenchEntityManager_t& ent_man,
+                    const std::string& tag,
+                    std::size_t n_ents,
+                    std::size_t frames)
+-> void
+{
+    Bench::Print(Bench::Measure(tag + "/integrate", n_ents * frames, [&] {
+        for (std::size_t f { 0 }; f < frames; ++f) {
+            ent_man.DoForEachComponentType<TMP::TypeList_t<Physics_t>>(
+                [](auto&& phy, auto&) {
+                    phy.pos += phy.vel;
+                });
+        }
+    }));
+
+    // Only reads the positions, the split layout skips the velocities
+    Bench::Print(Bench::Measure(tag + "/read_pos", n_ents * frames, [&] {
+        int sum { 0 };
+        for (std::size_t f { 0 }; f < frames; ++f) {
+            ent_man.DoForEachComponentType<TMP::TypeList_t<const Physics_t>>(
+                [&sum](const auto& phy, auto&) {
+                    sum += phy.pos.x;
+                });
+        }
+        Bench::DoNotOptimize(sum);
+    }));
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t n_ents
+    {
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000
+    };
+    const std::size_t frames
+    {
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20
+    };
+
+    BenchEntityManager_t ent_man {  };
+    ent_man.ReserveEntities(n_ents);
+    ent_man.ReserveComponents<PhysicsComponent_t>(n_ents);
+    ent_man.ReserveComponents<PhysicsAoS_t>(n_ents);
+    for (std::size_t i { 0 }; i < n_ents; ++i) {
+        auto& ent { ent_man.CreateEntity() };
+        const auto val { static_cast<int>(i % 640) };
+        ent_man.CreateRequieredComponent<PhysicsComponent_t>
+        (ent, VecInt{ val, val }, VecInt{ 1, -1 });
+        ent_man.CreateRequieredComponent<PhysicsAoS_t>
+        (ent, VecInt{ val, val }, VecInt{ 1, -1 });
+    }
+
+    RunLayoutBench<PhysicsAoS_t>(ent_man, "aos", n_ents, frames);
+    RunLayoutBench<PhysicsComponent_t>(ent_man, "soa", n_ents, frames);
+
+    return 0;
+}
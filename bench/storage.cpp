@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <string>
+
+#include <ecs/man/entity_manager.hpp>
+
+#include <game/cmp/health.hpp>
+#include <game/cmp/physics.hpp>
+
+#include "bench.hpp"
+
+// Map based entities, sparse set pools and archetype tables for the same
+// workload
+
+template<class StoragePolicy_t>
+using BenchEntityManager_t = ECS::BasicEntityManager_t<StoragePolicy_t,
+                                                       PhysicsComponent_t,
+                                                       HealthComponent_t>;
+
+template<class StoragePolicy_t>
+auto RunStorageBench(const std::string& tag, std::size_t n_ents) -> void
+{
+    BenchEntityManager_t<StoragePolicy_t> ent_man {  };
+
+    Bench::Print(Bench::Measure(tag + "/create", n_ents, [&] {
+        for (std::size_t i { 0 }; i < n_ents; ++i) {
+            auto& ent { ent_man.CreateEntity() };
+            ent_man.template CreateRequieredComponent<PhysicsComponent_t>
+                (ent, VecInt{ 1, 2 }, VecInt{ 3, 4 });
+            if (i % 2 == 0) {
+                ent_man.template CreateRequieredComponent<HealthComponent_t>
+                    (ent, 10u);
+            }
+        }
+    }));
+
+    Bench::Print(Bench::Measure(tag + "/get", n_ents, [&] {
+        for (std::size_t i { 0 }; i < n_ents; ++i) {
+            auto& ent { ent_man.GetEntityByID(i) };
+            auto&& phy
+            {
+                ent_man.template GetRequieredComponent<PhysicsComponent_t>(ent)
+            };
+            Bench::DoNotOptimize(phy.pos.x);
+        }
+    }));
+
+    Bench::Print(Bench::Measure(tag + "/foreach<Health, Physics>",
+                                n_ents / 2, [&] {
+        ent_man.template DoForEachComponentType
+        <TMP::TypeList_t<HealthComponent_t, PhysicsComponent_t>>(
+            [](HealthComponent_t& hel, auto&& phy, auto&) {
+                phy.pos.x += static_cast<int>(hel.health);
+            });
+    }));
+
+    // Physics is the larger pool, the view drives from Health anyway
+    Bench::Print(Bench::Measure(tag + "/view<Physics, Health>",
+                                n_ents / 2, [&] {
+        for (auto [phy, hel, ent] :
+             ent_man.template View<PhysicsComponent_t, HealthComponent_t>()) {
+            phy.pos.x += static_cast<int>(hel.health);
+        }
+    }));
+
+    Bench::Print(Bench::Measure(tag + "/match<Health, Physics>",
+                                n_ents, [&] {
+        std::size_t matched { 0 };
+        ent_man.template ForEachMatchingEntity
+        <TMP::TypeList_t<HealthComponent_t, PhysicsComponent_t>>(
+            [&matched](auto&) { ++matched; });
+        Bench::DoNotOptimize(matched);
+    }));
+
+    const auto n_rem { n_ents / 4 };
+    Bench::Print(Bench::Measure(tag + "/remove", n_rem, [&] {
+        for (std::size_t i { 0 }; i < n_rem; ++i) {
+            ent_man.RemoveEntity(ent_man.GetEntityByID(i * 2));
+        }
+    }));
+
+    Bench::Print(Bench::Measure(tag + "/recycle", n_rem, [&] {
+        for (std::size_t i { 0 }; i < n_rem; ++i) {
+            auto& ent { ent_man.CreateEntity() };
+            ent_man.template CreateRequieredComponent<PhysicsComponent_t>
+                (ent, VecInt{ 1, 2 }, VecInt{ 3, 4 });
+        }
+    }));
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t n_ents { 100000 };
+    if (argc > 1) {
+        n_ents = std::strtoull(argv[1], nullptr, 10);
+    }
+
+    RunStorageBench<ECS::EntityMapStorage_t>("map", n_ents);
+    RunStorageBench<ECS::SparseSetStorage_t>("sparse_set", n_ents);
+    RunStorageBench<ECS::ArchetypeStorage_t>("archetype", n_ents);
+
+    return 0;
+}
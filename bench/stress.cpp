@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ecs/man/entity_manager.hpp>
+#include <game/platform/null.hpp>
+#include <game/platform/recording.hpp>
+#include <game/util/gamefactory.hpp>
+
+#include "bench.hpp"
+
+// The frame of main.cpp without a window: the same manager, systems and
+// scheduler on the null platform, populated through GameFactory_t from a
+// scenario file, see bench/scenarios. Each count of the sweep is a new world
+// with the counts of the scenario scaled to that total and the sides scaled
+// to keep its density. Every frame is timed and every system on its own,
+// the systems of a level run at the same time so their times add up to more
+// than the frame. The health system writes to std::cout for every hit, the
+// console is muted while the frames run. Built with ECS_PERF_COUNTERS each
+// run ends with the report of the counters. With memory_every the memory of
+// the manager is printed every that many frames, out of the timings. Before
+// the timings the frame runs on the recording platform and must draw what
+// the manager holds
+//
+// usage: stress [--json file] [scenario] [entities...]
+
+using StressEntityManager_t = ECS::EntityManager_t<PhysicsComponent_t,
+                                                   RenderComponent_t,
+                                                   InputComponent_t,
+                                                   ColliderComponent_t,
+                                                   HealthComponent_t,
+                                                   SpawnComponent_t>;
+
+struct Scenario_t
+{
+    unsigned                 width        { 640 };
+    unsigned                 height       { 480 };
+    std::size_t              frames       { 600 };
+    std::uint32_t            seed         { 1 };
+    std::size_t              blades       {  };
+    std::size_t              platforms    {  };
+    std::size_t              spawners     {  };
+    std::size_t              players      {  };
+    std::size_t              memory_every {  };
+    std::vector<std::size_t> sweep        {  };
+
+    auto Total() const -> std::size_t
+    {
+        return blades + platforms + spawners + players;
+    }
+
+    // A count that isn't 0 stays at least 1
+    auto ScaledTo(std::size_t n_ents) const -> Scenario_t
+    {
+        const double factor
+        {
+            double(n_ents) / double(std::max<std::size_t>(Total(), 1))
+        };
+        auto scale {
+            [factor](std::size_t count) -> std::size_t {
+                if (count == 0) {
+                    return 0;
+                }
+                return std::max<std::size_t>(1, std::llround(count * factor));
+            }
+        };
+        Scenario_t scn { *this };
+        scn.width     = static_cast<unsigned>(width  * std::sqrt(factor));
+        scn.height    = static_cast<unsigned>(height * std::sqrt(factor));
+        scn.blades    = scale(blades);
+        scn.platforms = scale(platforms);
+        scn.spawners  = scale(spawners);
+        scn.players   = scale(players);
+        return scn;
+    }
+};
+
+// One "key values..." a line, # starts a comment
+auto LoadScenario(const char* path, Scenario_t& scn) -> bool
+{
+    std::ifstream file { path };
+    if (!file) {
+        std::fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+
+    std::string line {  };
+    for (std::size_t n_line { 1 }; std::getline(file, line); ++n_line) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields { line };
+        std::string key {  };
+        if (!(fields >> key)) {
+            continue;
+        }
+
+        bool ok { true };
+        if      (key == "width")     { ok = !!(fields >> scn.width);     }
+        else if (key == "height")    { ok = !!(fields >> scn.height);    }
+        else if (key == "frames")    { ok = !!(fields >> scn.frames);    }
+        else if (key == "seed")      { ok = !!(fields >> scn.seed);      }
+        else if (key == "blades")    { ok = !!(fields >> scn.blades);    }
+        else if (key == "platforms") { ok = !!(fields >> scn.platforms); }
+        else if (key == "spawners")  { ok = !!(fields >> scn.spawners);  }
+        else if (key == "players")   { ok = !!(fields >> scn.players);   }
+        else if (key == "memory_every") {
+            ok = !!(fields >> scn.memory_every);
+        }
+        else if (key == "sweep") {
+            scn.sweep.clear();
+            for (std::size_t n_ents {  }; fields >> n_ents;) {
+                scn.sweep.push_back(n_ents);
+            }
+            ok = !scn.sweep.empty() && fields.eof();
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::fprintf(stderr, "%s:%zu: bad line '%s'\n",
+                         path, n_line, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Times the Update of the system it wraps, with the same access list so the
+// scheduler builds the same plan. Only one task runs a system in a frame
+template<class System_t>
+struct TimedSystem_t
+{
+    using SystemSignature_t = typename System_t::SystemSignature_t;
+    using SystemResources_t = typename System_t::SystemResources_t;
+
+    template<class EntMan_t>
+    void Update(EntMan_t& ent_man)
+    {
+        ns = Bench::Measure("", 0, [&] { system.Update(ent_man); }).ns;
+    }
+
+    System_t& system;
+    double    ns {  };
+};
+
+struct Samples_t
+{
+    const char*         name {  };
+    std::vector<double> ns   {  };
+
+    // Nearest rank
+    auto Percentile(double q) const -> double
+    {
+        if (ns.empty()) {
+            return 0.0;
+        }
+        auto sorted { ns };
+        std::sort(sorted.begin(), sorted.end());
+        const auto rank
+        {
+            static_cast<std::size_t>(std::ceil(q * sorted.size()))
+        };
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    auto Total() const -> double
+    {
+        double total {  };
+        for (const auto t : ns) {
+            total += t;
+        }
+        return total;
+    }
+};
+
+// A platform and a player on RecordingPlatform_t: the three textures are
+// loaded once, each frame draws every body with a render component where it
+// is, and the player left idle past frames_to_sleep is still awake and
+// moves once its key goes down
+auto CheckRecordedFrames() -> bool
+{
+    RecordingPlatform_t   platform {  };
+    StressEntityManager_t ent_man  {  };
+
+    const
+    RenderSystem_t   ren_sys { platform, 640, 480, "Check" };
+    PhysicsSystem_t  phy_sys {  };
+    InputSystem_t    inp_sys { platform };
+    ColliderSystem_t col_sys { 640, 480 };
+    HealthSystem_t   hel_sys { col_sys.GetContacts() };
+    SleepSystem_t    slp_sys { col_sys.GetContacts() };
+
+    ECS::SystemScheduler_t sys_sched { phy_sys,
+                                       col_sys,
+                                       hel_sys,
+                                       inp_sys,
+                                       slp_sys };
+
+    GameFactory_t go_fact { ent_man, platform };
+    go_fact.CreatePlatform(500, 400);
+    go_fact.CreatePlayer(640, 480);
+
+    const std::vector<std::string> textures {
+        "assets/blade.png", "assets/platform.png", "assets/sprite.png"
+    };
+    if (platform.loaded != textures) {
+        std::printf("stress/check: %zu textures loaded, not the 3 of the"
+                    " factory\n", platform.loaded.size());
+        return false;
+    }
+    // The ids follow the order of the loads
+    constexpr std::uint32_t player_texture { 2 };
+
+    // Every texture drawn is a body, at its position and size
+    auto drawn_as_held {
+        [&platform, &ent_man] {
+            std::size_t n_bodies { 0 };
+            for (auto [ren, phy, e] :
+                 ent_man.template View<RenderComponent_t,
+                                       PhysicsComponent_t>()) {
+                ++n_bodies;
+                const auto& draws { platform.draws };
+                const bool drawn {
+                    std::any_of(draws.begin(), draws.end(),
+                        [&ren, &phy](const auto& d) {
+                            return d.texture         == ren.sprite.id
+                                   && d.rect.x      == float(phy.pos.x)
+                                   && d.rect.y      == float(phy.pos.y)
+                                   && d.rect.width  == ren.wh.x
+                                   && d.rect.height == ren.wh.y;
+                        })
+                };
+                if (!drawn) {
+                    return false;
+                }
+            }
+            return n_bodies == platform.draws.size();
+        }
+    };
+    auto player_x {
+        [&platform] {
+            for (const auto& d : platform.draws) {
+                if (d.texture == player_texture) {
+                    return d.rect.x;
+                }
+            }
+            return -1.0f;
+        }
+    };
+
+    auto* console { std::cout.rdbuf(nullptr) };
+    std::size_t frame { 0 };
+    bool ok { true };
+    auto run_frame {
+        [&] {
+            sys_sched.Update(ent_man);
+            ent_man.FlushCommandBuffer();
+            ren_sys.Update(ent_man);
+            ok = ok && drawn_as_held();
+            ++frame;
+        }
+    };
+    while (ok && frame <= slp_sys.frames_to_sleep + 1) {
+        run_frame();
+    }
+    const auto idle_frames { frame };
+    const auto idle_x      { player_x() };
+    bool idle_awake { true };
+    for (auto [inp, phy, e] :
+         ent_man.template View<InputComponent_t, PhysicsComponent_t>()) {
+        idle_awake = idle_awake && e.IsAwake();
+    }
+    platform.keys_down = { Key_t::D };
+    // The physics runs before the input, the velocity moves the next frame
+    run_frame();
+    run_frame();
+    const auto moved_x { player_x() };
+    std::cout.rdbuf(console);
+
+    if (!ok) {
+        std::printf("stress/check: frame %zu draws %zu textures that aren't"
+                    " the bodies of the manager\n",
+                    frame, platform.draws.size());
+        return false;
+    }
+    if (!idle_awake || moved_x != idle_x + 5) {
+        std::printf("stress/check: the player idle for %zu frames was %s,"
+                    " with its key down it went from x %.0f to %.0f\n",
+                    idle_frames, idle_awake ? "awake" : "asleep",
+                    idle_x, moved_x);
+        return false;
+    }
+    return true;
+}
+
+auto RunStress(const std::string& tag, const Scenario_t& scn) -> void
+{
+    // The render of the last frame tells the loop to stop, it isn't counted
+    NullPlatform_t        platform { scn.frames + 1, scn.seed };
+    StressEntityManager_t ent_man  {  };
+
+    RenderSystem_t   ren_sys { platform, scn.width, scn.height, "Stress" };
+    PhysicsSystem_t  phy_sys {  };
+    InputSystem_t    inp_sys { platform };
+    ColliderSystem_t col_sys { scn.width, scn.height };
+    HealthSystem_t   hel_sys { col_sys.GetContacts() };
+    SpawnSystem_t    spw_sys {  };
+    SleepSystem_t    slp_sys { col_sys.GetContacts() };
+
+    GameFactory_t go_fact { ent_man, platform };
+
+    const auto wh { static_cast<int>(scn.width)  };
+    const auto hg { static_cast<int>(scn.height) };
+    for (std::size_t i { 0 }; i < scn.spawners; ++i) {
+        go_fact.CreateSpawner(platform.GetRandomValue(0, wh),
+                              platform.GetRandomValue(0, hg),
+                              [&go_fact](int x, int y) {
+                                  go_fact.DeferBlade(x, y);
+                              });
+    }
+    for (std::size_t i { 0 }; i < scn.blades; ++i) {
+        go_fact.CreateRandomBlade(wh, hg);
+    }
+    for (std::size_t i { 0 }; i < scn.platforms; ++i) {
+        go_fact.CreatePlatform(platform.GetRandomValue(0, wh),
+                               platform.GetRandomValue(0, hg));
+    }
+    for (std::size_t i { 0 }; i < scn.players; ++i) {
+        go_fact.CreatePlayer(wh, hg);
+    }
+
+    TimedSystem_t<SpawnSystem_t>    spw_timed { spw_sys };
+    TimedSystem_t<PhysicsSystem_t>  phy_timed { phy_sys };
+    TimedSystem_t<ColliderSystem_t> col_timed { col_sys };
+    TimedSystem_t<HealthSystem_t>   hel_timed { hel_sys };
+    TimedSystem_t<InputSystem_t<NullPlatform_t>> inp_timed { inp_sys };
+    TimedSystem_t<SleepSystem_t>    slp_timed { slp_sys };
+
+    ECS::SystemScheduler_t sys_sched { spw_timed,
+                                       phy_timed,
+                                       col_timed,
+                                       hel_timed,
+                                       inp_timed,
+                                       slp_timed };
+
+    std::vector<Samples_t> samples {
+        { "frame" }, { "render" }, { "spawn" }, { "physics" }, { "collider" },
+        { "health" }, { "input" }, { "sleep" }, { "flush" }
+    };
+    for (auto& smp : samples) {
+        smp.ns.reserve(scn.frames);
+    }
+
+    ECS::MemorySummary_t mem_sum { scn.memory_every };
+
+    auto* console { std::cout.rdbuf(nullptr) };
+    const auto allocs { Bench::Allocations.load(std::memory_order_relaxed) };
+    for (bool running { true }; running;) {
+        double ren_ns {  };
+        double flush_ns {  };
+        const auto frame {
+            Bench::Measure("", 0, [&] {
+                ren_ns = Bench::Measure("", 0, [&] {
+                    running = ren_sys.Update(ent_man);
+                }).ns;
+                if (running) {
+                    sys_sched.Update(ent_man);
+                    flush_ns = Bench::Measure("", 0, [&] {
+                        ent_man.FlushCommandBuffer();
+                    }).ns;
+                }
+            })
+        };
+        if (!running) {
+            break;
+        }
+        const double frame_ns[] {
+            frame.ns, ren_ns, spw_timed.ns, phy_timed.ns, col_timed.ns,
+            hel_timed.ns, inp_timed.ns, slp_timed.ns, flush_ns
+        };
+        for (std::size_t i { 0 }; i < samples.size(); ++i) {
+            samples[i].ns.push_back(frame_ns[i]);
+        }
+        mem_sum.Update(ent_man);
+    }
+    const auto frame_allocs {
+        Bench::Allocations.load(std::memory_order_relaxed) - allocs
+    };
+    std::cout.rdbuf(console);
+
+    const auto n_frames { samples[0].ns.size() };
+    std::printf("%s: %zu blades, %zu platforms, %zu spawners, %zu players,"
+                " %ux%u, %zu frames, %.1f allocs/frame\n",
+                tag.c_str(), scn.blades, scn.platforms, scn.spawners,
+                scn.players, scn.width, scn.height, n_frames,
+                n_frames ? double(frame_allocs) / double(n_frames) : 0.0);
+    std::printf("  %-10s %12s %12s %12s %12s\n",
+                "", "p50 us", "p99 us", "max us", "mean us");
+    for (const auto& smp : samples) {
+        const auto total { smp.Total() };
+        std::printf("  %-10s %12.1f %12.1f %12.1f %12.1f\n", smp.name,
+                    smp.Percentile(0.5) / 1e3, smp.Percentile(0.99) / 1e3,
+                    smp.Percentile(1.0) / 1e3,
+                    n_frames ? total / double(n_frames) / 1e3 : 0.0);
+        Bench::Results.push_back({ tag + "/" + smp.name, n_frames, total,
+                                   &smp == &samples[0] ? frame_allocs : 0 });
+    }
+
+#ifdef ECS_PERF_COUNTERS
+    ECS::PerfCounters_t::Get().Report();
+    ECS::PerfCounters_t::Get().Reset();
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    const char* json { Bench::TakeJsonPath(argc, argv) };
+    const char* path { argc > 1 ? argv[1] : "bench/scenarios/default.txt" };
+
+    Scenario_t scn {  };
+    if (!LoadScenario(path, scn)) {
+        return 1;
+    }
+    if (argc > 2) {
+        scn.sweep.clear();
+        for (int i { 2 }; i < argc; ++i) {
+            scn.sweep.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+    }
+
+    if (!CheckRecordedFrames()) {
+        return 1;
+    }
+
+    if (scn.sweep.empty()) {
+        RunStress("stress/" + std::to_string(scn.Total()), scn);
+    }
+    for (const auto n_ents : scn.sweep) {
+        RunStress("stress/" + std::to_string(n_ents), scn.ScaledTo(n_ents));
+    }
+
+    if (json && !Bench::WriteJson(json)) {
+        return 1;
+    }
+    return 0;
+}
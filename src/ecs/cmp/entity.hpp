@@ -12,6 +12,16 @@ namespace ECS
 
 struct EntityBase_t
 {
+    // The map keeps its buckets when it's cleared. libstdc++ keeps a single
+    // bucket in place and allocates a node for each element
+    auto GetHeapBytes() const -> std::size_t
+    {
+        using Node_t = std::pair<void*, decltype(m_Comps)::value_type>;
+        const auto buckets { m_Comps.bucket_count() > 1
+                             ? m_Comps.bucket_count() * sizeof(void*) : 0 };
+        return buckets + m_Comps.size() * sizeof(Node_t);
+    }
+
 protected:
 
     auto AttachComponentID(ComponentTypeID_t cmp_tp_id,
@@ -61,6 +71,16 @@ protected:
         m_Comps[cmp_tp_id] = cmp_id;
     }
 
+    auto DetachComponentID(ComponentTypeID_t cmp_tp_id) -> void
+    {
+        m_Comps.erase(cmp_tp_id);
+    }
+
+    auto DetachAllComponentIDs() -> void
+    {
+        m_Comps.clear();
+    }
+
     decltype(auto) begin()        { return m_Comps.begin(); }
     decltype(auto) begin()  const { return m_Comps.begin(); }
     decltype(auto) cbegin() const { return m_Comps.cbegin(); }
@@ -72,16 +92,47 @@ private:
     std::unordered_map<ComponentTypeID_t, ComponentID_t> m_Comps {  };
 };
 
-template<class EntMan_t>
-struct Entity_t final : public EntityBase_t,
+// The components of the entity are found through the storage pools, so the
+// entity itself is only its ID
+struct EmptyEntityBase_t
+{
+    constexpr auto GetHeapBytes() const -> std::size_t { return 0; }
+};
+
+// Index of the entity slot plus the generation of the slot when the handle was
+// taken, the slot generation changes every time its entity is removed so a
+// stale handle is found with one compare
+struct EntityHandle_t
+{
+    EntityID_t         index      { InvalidEntityID };
+    EntityGeneration_t generation {  };
+
+    constexpr auto operator==(const EntityHandle_t& other) const -> bool
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    constexpr auto operator!=(const EntityHandle_t& other) const -> bool
+    {
+        return !(*this == other);
+    }
+};
+
+// Signature_t has one bit for each component type of the manager, the bit is
+// set while the entity has a component of that type
+template<class EntMan_t, class Signature_t, class Base_t = EntityBase_t>
+struct Entity_t final : public Base_t,
                                Uncopyable_t
 {
     friend EntMan_t;
 
     explicit constexpr
-    Entity_t(Entity_t<EntMan_t>&& ent_temp)
-        : EntityBase_t { std::move(ent_temp) },
-          m_ID { ent_temp.m_ID } {  }
+    Entity_t(Entity_t<EntMan_t, Signature_t, Base_t>&& ent_temp)
+        : Base_t { std::move(ent_temp) },
+          m_ID { ent_temp.m_ID },
+          m_Generation { ent_temp.m_Generation },
+          m_Signature { ent_temp.m_Signature },
+          m_Awake { ent_temp.m_Awake } {  }
 
     constexpr auto GetEntityID() const -> EntityID_t
     {
@@ -93,19 +144,46 @@ struct Entity_t final : public EntityBase_t,
         return m_ID;
     }
 
-private:
+    constexpr auto GetGeneration() const -> EntityGeneration_t
+    {
+        return m_Generation;
+    }
 
-    explicit constexpr Entity_t(EntityID_t ent_id) : m_ID { ent_id } {  };
+    constexpr auto GetHandle() const -> EntityHandle_t
+    {
+        return { m_ID, m_Generation };
+    }
+
+    constexpr auto IsAlive() const -> bool
+    {
+        return m_ID != InvalidEntityID;
+    }
 
-    constexpr
-    auto operator=(const Entity_t<EntMan_t>& other)
-    -> Entity_t&
+    // An entity asleep has its components with the other asleep ones, apart
+    // from the rows the systems walk every frame
+    constexpr auto IsAwake() const -> bool
     {
-        EntityBase_t::operator=(std::move(other));
-        return *this;
+        return m_Awake;
     }
 
-    EntityID_t m_ID {  };
+    constexpr auto GetSignature() const -> const Signature_t&
+    {
+        return m_Signature;
+    }
+
+    auto HasSignature(const Signature_t& sig) const -> bool
+    {
+        return (m_Signature & sig) == sig;
+    }
+
+private:
+
+    explicit constexpr Entity_t(EntityID_t ent_id) : m_ID { ent_id } {  };
+
+    EntityID_t         m_ID         {  };
+    EntityGeneration_t m_Generation {  };
+    Signature_t        m_Signature  {  };
+    bool               m_Awake      { true };
 };
 
 } // namespace ECS
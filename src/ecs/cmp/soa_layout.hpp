@@ -0,0 +1,68 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ECS
+{
+
+// A component opts in to the structure of arrays layout specializing
+// SoALayout_t with the pointers to its fields and the proxies that the pool
+// hands out instead of references. The proxies are aggregates built from
+// references to the fields, in the order of Fields:
+//
+//     template<> struct SoALayout_t<Cmp_t>
+//     {
+//         constexpr static inline auto Fields
+//         {
+//             std::make_tuple(&Cmp_t::a, &Cmp_t::b)
+//         };
+//         using Ref_t      = CmpRef_t<A, B>;
+//         using ConstRef_t = CmpRef_t<const A, const B>;
+//     };
+//
+// Only the sparse set storage splits the fields, the other policies keep
+// storing the whole component
+template<class T>
+struct SoALayout_t {  };
+
+template<class T, class = void>
+struct IsSoA_t : std::false_type {  };
+
+template<class T>
+struct IsSoA_t<T, std::void_t<decltype(SoALayout_t<T>::Fields)>>
+: std::true_type {  };
+
+template<class T>
+constexpr inline bool IsSoA { IsSoA_t<T>::value };
+
+// What the pools hand out for a component, references or the proxies of the
+// layout when its fields are split
+template<class T, bool Split = IsSoA<T>>
+struct ComponentRefs_t
+{
+    using Ref_t      = T&;
+    using ConstRef_t = const T&;
+};
+
+template<class T>
+struct ComponentRefs_t<T, true>
+{
+    using Ref_t      = typename SoALayout_t<T>::Ref_t;
+    using ConstRef_t = typename SoALayout_t<T>::ConstRef_t;
+};
+
+template<class Class_t, class Field_t>
+auto FieldTypeOf(Field_t Class_t::*) -> Field_t;
+
+template<class T, std::size_t I>
+using SoAField_t = decltype(FieldTypeOf(std::get<I>(SoALayout_t<T>::Fields)));
+
+template<class T>
+constexpr inline std::size_t SoAFieldCount
+{
+    std::tuple_size_v<std::remove_const_t<decltype(SoALayout_t<T>::Fields)>>
+};
+
+} // namespace ECS
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <bitset>
+#include <cassert>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <ecs/util/type_aliases.hpp>
+#include <ecs/util/helpers.hpp>
+#include <ecs/man/memory_report.hpp>
+
+namespace ECS
+{
+
+// Entities with the same set of components live in the same table, a table
+// keeps one column for each component type, the columns of the components
+// that are not in the signature of the table are always empty
+template<class... Components_t>
+struct ArchetypeTable_t
+{
+    using Signature_t = std::bitset<sizeof...(Components_t)>;
+
+    constexpr explicit ArchetypeTable_t(Signature_t sig) : mSignature { sig }
+    {  }
+
+    constexpr auto size() const -> std::size_t { return mEntities.size(); }
+
+    Signature_t                          mSignature {  };
+    Storage_t<EntityID_t>                mEntities  {  };
+    Elements_t<Storage_t<Components_t>...> mColumns {  };
+};
+
+template<class EntMan_t> class ArchetypeComponentStorage_t;
+
+template<template<class, class...> class EntMan_t,
+         class    StoragePolicy_t,
+         class... Components_t>
+class ArchetypeComponentStorage_t<EntMan_t<StoragePolicy_t, Components_t...>>
+final : Uncopyable_t
+{
+
+public:
+
+    using Signature_t = std::bitset<sizeof...(Components_t)>;
+    using Table_t     = ArchetypeTable_t<Components_t...>;
+
+    // There is no single pool for a component type, every table keeps its
+    // own column of it
+    template<class T>
+    using VecComponent_t = Storage_t<T>;
+
+    // The columns keep whole components, SoA layouts are not split
+    template<class T>
+    constexpr static inline bool IsSplit { false };
+
+    template<class T>
+    using Ref_t = std::conditional_t<
+                        std::is_const_v<std::remove_reference_t<T>>,
+                        const RemovePCR<T>&,
+                        RemovePCR<T>&>;
+
+    template<class T>
+    using ConstRef_t = const RemovePCR<T>&;
+
+    struct Location_t
+    {
+        std::size_t table { npos };
+        std::size_t row   { npos };
+    };
+
+    constexpr static inline std::size_t npos { ~std::size_t{ 0 } };
+
+    constexpr explicit ArchetypeComponentStorage_t()
+    {
+        static_assert(AreUnique_t<Components_t...>::value,
+                      "Components need to be unique");
+    }
+
+    template<typename ReqCmp_t>
+    static constexpr auto
+    GetRequiredComponentTypeID()
+    -> ComponentTypeID_t
+    {
+        static_assert(IsOneOf<RemovePCR<ReqCmp_t>, Components_t...>::value,
+                      "The requiered component type does not"
+                      " exist in this ArchetypeComponentStorage_t");
+        auto index
+        {
+            IndexOfElement_t<RemovePCR<ReqCmp_t>,
+                             Elements_t<Components_t...>>::value
+        };
+        return static_cast<ComponentTypeID_t>(index);
+    }
+
+    template<typename ReqCmp_t, typename ...Args_t>
+    constexpr auto
+    CreateRequieredComponent(EntityID_t eid, Args_t&& ...args)
+    -> Combine_t<ComponentID_t, ReqCmp_t&>
+    {
+        return
+        std::get<0>(CreateRequieredComponents<ReqCmp_t>
+                    (eid, MakeArgs(std::forward<Args_t>(args)...)));
+    }
+
+    // The entity is moved once to the table of its new signature and then
+    // the new components are appended to the row. A component the entity
+    // already has is assigned over the one in its row
+    template<typename... ReqCmps_t, typename... TupleArgs_t>
+    constexpr auto
+    CreateRequieredComponents(EntityID_t eid, TupleArgs_t&&... args)
+    -> Elements_t<Combine_t<ComponentID_t, ReqCmps_t&>...>
+    {
+        if constexpr (sizeof...(TupleArgs_t) < sizeof...(ReqCmps_t))
+        {
+            constexpr auto diff {sizeof...(ReqCmps_t) - sizeof...(TupleArgs_t)};
+            return
+            std::apply([this, eid](auto&&... all_args) {
+                return CreateRequieredComponents<ReqCmps_t...>
+                       (eid, std::forward<decltype(all_args)>(all_args)...);
+            }, std::tuple_cat(std::forward_as_tuple(
+                              std::forward<TupleArgs_t>(args)...),
+                              MakeEmptyArgs(std::make_index_sequence<diff>{})));
+        } else {
+            const Signature_t new_cmps
+            {
+                (0ULL | ... | (1ULL << GetRequiredComponentTypeID<ReqCmps_t>()))
+            };
+            const auto old_sig { GetSignatureByEntity(eid) };
+            const auto loc     { MoveEntity(eid, old_sig | new_cmps) };
+            auto& table { mTables[loc.table] };
+
+            return
+            {
+                Combine_t<ComponentID_t, ReqCmps_t&>
+                {
+                    loc.row,
+                    EmplaceFromTuple<ReqCmps_t>
+                    (
+                     std::get<Storage_t<ReqCmps_t>>(table.mColumns),
+                     old_sig.test(GetRequiredComponentTypeID<ReqCmps_t>())
+                     ? loc.row : npos,
+                     std::forward<TupleArgs_t>(args),
+                     std::make_index_sequence<std::tuple_size_v<
+                     std::remove_reference_t<TupleArgs_t>>>{}
+                    )
+                }...
+            };
+        }
+    }
+
+    // Moves the entity once to the table of its signature plus sig, the
+    // components it didn't have are default constructed in its new row
+    auto
+    CreateDefaultComponentsByEntity(EntityID_t eid, Signature_t sig)
+    -> void
+    {
+        const auto old_sig { GetSignatureByEntity(eid) };
+        const auto loc     { MoveEntity(eid, old_sig | sig) };
+        if (loc.table != npos) {
+            EmplaceDefaultColumns(mTables[loc.table], old_sig,
+                                  std::index_sequence_for<Components_t...>{});
+        }
+    }
+
+    auto
+    GetSignatureByEntity(EntityID_t eid) const
+    -> Signature_t
+    {
+        auto loc { GetLocation(eid) };
+        return loc.table == npos ? Signature_t{  }
+                                 : mTables[loc.table].mSignature;
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredComponentByEntity(EntityID_t eid) const
+    -> const RemovePCR<ReqCmp_t>&
+    {
+        auto loc { GetLocation(eid) };
+        assert_msg(loc.table != npos
+                   && mTables[loc.table].mSignature.test(
+                                    GetRequiredComponentTypeID<ReqCmp_t>()),
+                   "The entity doesn't have the component");
+
+        return std::get<Storage_t<RemovePCR<ReqCmp_t>>>
+               (mTables[loc.table].mColumns)[loc.row];
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredComponentByEntity(EntityID_t eid)
+    -> RemovePCR<ReqCmp_t>&
+    {
+        return SameAsConstMemFunc
+               (
+                this,
+                &ArchetypeComponentStorage_t::template
+                GetRequieredComponentByEntity<ReqCmp_t>,
+                eid
+               );
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    SetRequieredComponentByEntity(EntityID_t eid, RemovePCR<ReqCmp_t>&& cmp)
+    -> void
+    {
+        GetRequieredComponentByEntity<ReqCmp_t>(eid) = std::move(cmp);
+    }
+
+    // The table that receives the components is only known once they are
+    // attached, so there is nothing to reserve up front
+    template<typename ReqCmp_t>
+    constexpr auto
+    ReserveComponents([[maybe_unused]] std::size_t n)
+    -> void
+    {  }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    RemoveComponentByEntity(EntityID_t eid)
+    -> void
+    {
+        Signature_t sig { GetSignatureByEntity(eid) };
+        sig.reset(GetRequiredComponentTypeID<ReqCmp_t>());
+        MoveEntity(eid, sig);
+    }
+
+    constexpr auto
+    RemoveComponentsByEntity(EntityID_t eid)
+    -> void
+    {
+        auto loc { GetLocation(eid) };
+        if (loc.table != npos) {
+            RemoveRow(loc.table, loc.row);
+            mLocations[static_cast<std::size_t>(eid)] = Location_t{  };
+        }
+    }
+
+    // Calls callable(eid, cmps...) for every row of the tables that have all
+    // the requiered components, the columns are walked in lockstep
+    template<class... ReqCmps_t, class Callable_t>
+    constexpr auto
+    ForEachRow(Callable_t&& callable)
+    -> void
+    {
+        const Signature_t sig
+        {
+            (0ULL | ... | (1ULL << GetRequiredComponentTypeID<ReqCmps_t>()))
+        };
+
+        for (std::size_t t { 0 }; t < mTables.size(); ++t) {
+            if ((mTables[t].mSignature & sig) != sig) {
+                continue;
+            }
+            for (std::size_t row { 0 }; row < mTables[t].size(); ++row) {
+                auto& table { mTables[t] };
+                callable(table.mEntities[row],
+                         std::get<Storage_t<RemovePCR<ReqCmps_t>>>
+                         (table.mColumns)[row]...);
+            }
+        }
+    }
+
+    // The pool of a component type is its column in every table, the
+    // entity IDs of a row are shared by the columns so they aren't in it
+    template<typename ReqCmp_t>
+    auto GetPoolMemory() const -> PoolMemory_t
+    {
+        using Cmp_t = RemovePCR<ReqCmp_t>;
+
+        PoolMemory_t pool { TypeName<Cmp_t>() };
+        pool.row_bytes = sizeof(Cmp_t);
+        for (const auto& table : mTables) {
+            const auto& column { std::get<Storage_t<Cmp_t>>(table.mColumns) };
+            pool.count    += column.size();
+            pool.capacity += column.capacity();
+            for (const auto& cmp : column) {
+                pool.heap_bytes += ComponentHeapBytes(cmp);
+            }
+        }
+        return pool;
+    }
+
+    // The tables with their entity IDs and the locations of the entities.
+    // The table index map is counted as its nodes and buckets
+    auto GetStorageBytes() const -> std::size_t
+    {
+        auto bytes { mTables.capacity() * sizeof(Table_t)
+                     + mLocations.capacity() * sizeof(Location_t)
+                     + mTableIndexes.bucket_count() * sizeof(void*)
+                     + mTableIndexes.size()
+                       * (sizeof(void*) + sizeof(
+                          typename decltype(mTableIndexes)::value_type)) };
+        for (const auto& table : mTables) {
+            bytes += table.mEntities.capacity() * sizeof(EntityID_t);
+        }
+        return bytes;
+    }
+
+    constexpr auto GetTables() const -> const Storage_t<Table_t>&
+    {
+        return mTables;
+    }
+
+    constexpr auto GetTables() -> Storage_t<Table_t>&
+    {
+        return SameAsConstMemFunc(this,
+                                  &ArchetypeComponentStorage_t::GetTables);
+    }
+
+private:
+
+    // Appends the component, or assigns it over the one at row when the
+    // row already has it
+    template<class ReqCmp_t, class TupleArgs_t, std::size_t... I>
+    static constexpr auto
+    EmplaceFromTuple(Storage_t<ReqCmp_t>& column,
+                     std::size_t row,
+                     TupleArgs_t&& args,
+                     std::index_sequence<I...>)
+    -> ReqCmp_t&
+    {
+        ReqCmp_t cmp { std::get<I>(std::forward<TupleArgs_t>(args))... };
+        if (row != npos) {
+            column[row] = std::move(cmp);
+            return column[row];
+        }
+        column.push_back(std::move(cmp));
+        return column.back();
+    }
+
+    auto
+    GetLocation(EntityID_t eid) const
+    -> Location_t
+    {
+        auto index { static_cast<std::size_t>(eid) };
+        return index < mLocations.size() ? mLocations[index] : Location_t{  };
+    }
+
+    auto
+    SetLocation(EntityID_t eid, Location_t loc)
+    -> void
+    {
+        auto index { static_cast<std::size_t>(eid) };
+        if (index >= mLocations.size()) {
+            mLocations.resize(index + 1);
+        }
+        mLocations[index] = loc;
+    }
+
+    auto
+    GetOrCreateTable(Signature_t sig)
+    -> std::size_t
+    {
+        auto [ite, inserted] { mTableIndexes.try_emplace(sig.to_ullong(),
+                                                         mTables.size()) };
+        if (inserted) {
+            mTables.emplace_back(sig);
+        }
+        return ite->second;
+    }
+
+    // Moves the row of the entity to the table of the new signature, only
+    // the components that are in both signatures are carried
+    auto
+    MoveEntity(EntityID_t eid, Signature_t new_sig)
+    -> Location_t
+    {
+        const auto old_loc { GetLocation(eid) };
+
+        if (new_sig.none()) {
+            RemoveComponentsByEntity(eid);
+            return {  };
+        }
+
+        const auto new_table { GetOrCreateTable(new_sig) };
+        if (old_loc.table == new_table) {
+            return old_loc;
+        }
+
+        auto& dst { mTables[new_table] };
+        const Location_t new_loc { new_table, dst.size() };
+        dst.mEntities.push_back(eid);
+
+        if (old_loc.table != npos) {
+            auto& src { mTables[old_loc.table] };
+            MoveColumns(src, dst, old_loc.row,
+                        std::index_sequence_for<Components_t...>{});
+            RemoveRow(old_loc.table, old_loc.row);
+        }
+
+        SetLocation(eid, new_loc);
+        return new_loc;
+    }
+
+    template<std::size_t... I>
+    static auto
+    MoveColumns(Table_t& src, Table_t& dst, std::size_t row,
+                std::index_sequence<I...>)
+    -> void
+    {
+        const auto common { src.mSignature & dst.mSignature };
+        ((common.test(I)
+          ? (void)std::get<I>(dst.mColumns).push_back(
+                                        std::move(std::get<I>(src.mColumns)[row]))
+          : (void)0), ...);
+    }
+
+    template<std::size_t... I>
+    static auto
+    EmplaceDefaultColumns(Table_t& table, Signature_t old_sig,
+                          std::index_sequence<I...>)
+    -> void
+    {
+        ((table.mSignature.test(I) && !old_sig.test(I)
+          ? (void)std::get<I>(table.mColumns).emplace_back()
+          : (void)0), ...);
+    }
+
+    template<std::size_t... I>
+    static auto
+    SwapRemoveColumns(Table_t& table, std::size_t row,
+                      std::index_sequence<I...>)
+    -> void
+    {
+        auto swap_remove {
+            [row](auto& column) {
+                if (row + 1 != column.size()) {
+                    column[row] = std::move(column.back());
+                }
+                column.pop_back();
+            }
+        };
+        ((table.mSignature.test(I)
+          ? swap_remove(std::get<I>(table.mColumns))
+          : (void)0), ...);
+    }
+
+    auto
+    RemoveRow(std::size_t table_index, std::size_t row)
+    -> void
+    {
+        auto& table { mTables[table_index] };
+        SwapRemoveColumns(table, row,
+                          std::index_sequence_for<Components_t...>{});
+
+        const auto moved_eid { table.mEntities.back() };
+        if (row + 1 != table.size()) {
+            table.mEntities[row] = moved_eid;
+            SetLocation(moved_eid, Location_t{ table_index, row });
+        }
+        table.mEntities.pop_back();
+    }
+
+    Storage_t<Table_t>                   mTables       {  };
+    Storage_t<Location_t>                mLocations    {  };
+    std::unordered_map<unsigned long long,
+                       std::size_t>      mTableIndexes {  };
+};
+
+} // namespace ECS
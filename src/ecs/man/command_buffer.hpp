@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include <ecs/util/type_aliases.hpp>
+#include <ecs/util/helpers.hpp>
+#include <ecs/cmp/entity.hpp>
+
+namespace ECS
+{
+
+// The recorder of the calling thread, 0 records into the command buffer of
+// the manager and any other one into a buffer of its own, see
+// EntityManager_t::GetCommandBuffer
+inline thread_local std::size_t tRecorder { 0 };
+
+// SystemScheduler_t gives every system a recorder, the systems of a level
+// record at the same time without sharing a buffer. The tasks a system hands
+// to the pool run with recorder 0, they must not record
+class RecorderScope_t final
+{
+
+public:
+
+    explicit RecorderScope_t(std::size_t recorder) : mPrevious { tRecorder }
+    {
+        tRecorder = recorder;
+    }
+
+    ~RecorderScope_t() { tRecorder = mPrevious; }
+
+    RecorderScope_t(const RecorderScope_t&) = delete;
+    auto operator=(const RecorderScope_t&) -> RecorderScope_t& = delete;
+
+private:
+
+    std::size_t mPrevious {  };
+};
+
+// An entity that will be created when the command buffer is flushed
+struct DeferredEntity_t
+{
+    std::uint32_t index {  };
+};
+
+// Records the structural changes requested while the pools are being
+// iterated, Flush applies them all at once: first the new entities, then the
+// new components grouped by type, then the removed components, then the
+// entities put to sleep and the woken ones, so a wake wins over a sleep, and
+// last the removed entities, every pool once for all of them. With the
+// archetype storage an entity that gets components moves once, to the table
+// of all of them, before they are set
+template<class EntMan_t> class CommandBuffer_t;
+
+template<template<class, class...> class EntMan_t,
+         class    StoragePolicy_t,
+         class... Components_t>
+class CommandBuffer_t<EntMan_t<StoragePolicy_t, Components_t...>> final
+: Uncopyable_t
+{
+
+public:
+
+    struct Target_t
+    {
+        EntityHandle_t handle   {  };
+        bool           deferred { false };
+    };
+
+    template<class T>
+    using Attach_t = Combine_t<Target_t, T>;
+
+    constexpr explicit CommandBuffer_t() = default;
+
+    auto CreateEntity() -> DeferredEntity_t
+    {
+        return { mCreatedCount++ };
+    }
+
+    auto RemoveEntity(EntityHandle_t handle) -> void
+    {
+        mRemovedEntities.push_back(MakeTarget(handle));
+    }
+
+    auto RemoveEntity(DeferredEntity_t ent) -> void
+    {
+        mRemovedEntities.push_back(MakeTarget(ent));
+    }
+
+    auto Sleep(EntityHandle_t handle) -> void
+    {
+        mSlept.push_back(handle);
+    }
+
+    auto Wake(EntityHandle_t handle) -> void
+    {
+        mWoken.push_back(handle);
+    }
+
+    // The returned component lives in the buffer, it is valid until the next
+    // component of the same type is recorded
+    template<class ReqCmp_t, class Ent_t, class... Args_t>
+    auto CreateRequieredComponent(Ent_t ent, Args_t&&... args) -> ReqCmp_t&
+    {
+        auto& attaches { std::get<Storage_t<Attach_t<ReqCmp_t>>>(mAttaches) };
+        attaches.emplace_back(MakeTarget(ent),
+                              ReqCmp_t{ std::forward<Args_t>(args)... });
+        return attaches.back().second;
+    }
+
+    // Same as the one of the manager, the arguments of each component come
+    // in a tuple, see MakeArgs
+    template<class... ReqCmps_t, class Ent_t, class... TupleArgs_t>
+    auto CreateRequieredComponents(Ent_t ent, TupleArgs_t&&... args)
+    -> Elements_t<ReqCmps_t&...>
+    {
+        static_assert(sizeof...(ReqCmps_t) == sizeof...(TupleArgs_t),
+                      "Every component needs the tuple of its arguments");
+        return
+        {
+            std::apply([this, ent](auto&&... cmp_args) -> ReqCmps_t& {
+                return CreateRequieredComponent<ReqCmps_t>(
+                            ent, std::forward<decltype(cmp_args)>(cmp_args)...);
+            }, std::forward<TupleArgs_t>(args))...
+        };
+    }
+
+    template<class ReqCmp_t, class Ent_t>
+    auto RemoveRequieredComponent(Ent_t ent) -> void
+    {
+        constexpr auto index
+        {
+            IndexOfElement_t<ReqCmp_t, Elements_t<Components_t...>>::value
+        };
+        mDetaches[index].push_back(MakeTarget(ent));
+    }
+
+    auto IsEmpty() const -> bool
+    {
+        auto no_attaches {
+            std::apply([](auto&... attaches) {
+                return (attaches.empty() && ...);
+            }, mAttaches)
+        };
+        auto no_detaches {
+            std::all_of(mDetaches.begin(), mDetaches.end(),
+                        [](auto& detaches) { return detaches.empty(); })
+        };
+        return mCreatedCount == 0 && mRemovedEntities.empty()
+            && mSlept.empty() && mWoken.empty()
+            && no_attaches && no_detaches;
+    }
+
+    // The arrays keep their capacity between flushes
+    auto GetReservedBytes() const -> std::size_t
+    {
+        auto bytes { mCreated.capacity() * sizeof(EntityHandle_t)
+                     + mRemovedEntities.capacity() * sizeof(Target_t)
+                     + mRemovedHandles.capacity() * sizeof(EntityHandle_t)
+                     + mPending.capacity() * sizeof(Pending_t)
+                     + mSlept.capacity() * sizeof(EntityHandle_t)
+                     + mWoken.capacity() * sizeof(EntityHandle_t) };
+        std::apply([&bytes](const auto&... attaches) {
+            ((bytes += attaches.capacity()
+                       * sizeof(typename std::decay_t<
+                                decltype(attaches)>::value_type)), ...);
+        }, mAttaches);
+        for (const auto& detaches : mDetaches) {
+            bytes += detaches.capacity() * sizeof(Target_t);
+        }
+        return bytes;
+    }
+
+    // Moves the records of other after the ones of this buffer, as if they
+    // were recorded here, and clears other. Its entities are created after
+    // the ones of this buffer
+    auto Append(CommandBuffer_t& other) -> void
+    {
+        const auto offset { mCreatedCount };
+        mCreatedCount += other.mCreatedCount;
+        for (const auto& target : other.mRemovedEntities) {
+            mRemovedEntities.push_back(Offset(target, offset));
+        }
+        mSlept.insert(mSlept.end(), other.mSlept.begin(), other.mSlept.end());
+        mWoken.insert(mWoken.end(), other.mWoken.begin(), other.mWoken.end());
+        AppendAttaches(other, offset, std::index_sequence_for<Components_t...>{});
+        for (std::size_t i { 0 }; i < mDetaches.size(); ++i) {
+            for (const auto& target : other.mDetaches[i]) {
+                mDetaches[i].push_back(Offset(target, offset));
+            }
+        }
+        other.Clear();
+    }
+
+    template<class EntManager_t>
+    auto Flush(EntManager_t& ent_man) -> void
+    {
+        mCreated.clear();
+        ent_man.ReserveEntities(mCreatedCount);
+        for (std::uint32_t i { 0 }; i < mCreatedCount; ++i) {
+            mCreated.push_back(ent_man.CreateEntity().GetHandle());
+        }
+
+        if constexpr (EntManager_t::IsArchetype) {
+            CreatePendingComponents(ent_man,
+                                    std::index_sequence_for<Components_t...>{});
+        }
+        (FlushAttachesOfType<Components_t>(ent_man), ...);
+        FlushDetaches(ent_man, std::index_sequence_for<Components_t...>{});
+
+        if constexpr (EntManager_t::IsSparseSet) {
+            for (const auto handle : mSlept) {
+                ent_man.Sleep(handle);
+            }
+        }
+        for (const auto handle : mWoken) {
+            ent_man.Wake(handle);
+        }
+
+        mRemovedHandles.clear();
+        for (const auto& target : mRemovedEntities) {
+            mRemovedHandles.push_back(Resolve(target));
+        }
+        ent_man.RemoveEntities(mRemovedHandles);
+
+        Clear();
+        Reserve(ent_man.GetAliveEntitiesCount());
+    }
+
+    // Any frame can then sleep, wake or remove every entity alive without
+    // growing the buffer
+    auto Reserve(std::size_t n_alive) -> void
+    {
+        ReserveAtLeast(mRemovedEntities, n_alive);
+        ReserveAtLeast(mRemovedHandles, n_alive);
+        ReserveAtLeast(mSlept, n_alive);
+        ReserveAtLeast(mWoken, n_alive);
+    }
+
+    auto Clear() -> void
+    {
+        mCreatedCount = 0;
+        mRemovedEntities.clear();
+        mSlept.clear();
+        mWoken.clear();
+        std::apply([](auto&... attaches) {
+            (attaches.clear(), ...);
+        }, mAttaches);
+        for (auto& detaches : mDetaches) {
+            detaches.clear();
+        }
+    }
+
+private:
+
+    static constexpr auto MakeTarget(EntityHandle_t handle) -> Target_t
+    {
+        return { handle, false };
+    }
+
+    static constexpr auto MakeTarget(DeferredEntity_t ent) -> Target_t
+    {
+        return { EntityHandle_t{ ent.index, 0 }, true };
+    }
+
+    static constexpr auto Offset(Target_t target, std::uint32_t offset)
+    -> Target_t
+    {
+        if (target.deferred) {
+            target.handle.index += offset;
+        }
+        return target;
+    }
+
+    template<std::size_t... I>
+    auto AppendAttaches(CommandBuffer_t& other,
+                        std::uint32_t offset,
+                        std::index_sequence<I...>)
+    -> void
+    {
+        (AppendAttachesOfType(std::get<I>(mAttaches),
+                              std::get<I>(other.mAttaches),
+                              offset), ...);
+    }
+
+    template<class Attaches_t>
+    static auto AppendAttachesOfType(Attaches_t&   attaches,
+                                     Attaches_t&   other,
+                                     std::uint32_t offset)
+    -> void
+    {
+        for (auto& [target, cmp] : other) {
+            attaches.emplace_back(Offset(target, offset), std::move(cmp));
+        }
+    }
+
+    auto Resolve(const Target_t& target) const -> EntityHandle_t
+    {
+        return target.deferred ? mCreated[target.handle.index]
+                               : target.handle;
+    }
+
+    // The types of the components recorded for each entity, by the index of
+    // the type in the signature
+    struct Pending_t
+    {
+        EntityHandle_t handle {  };
+        std::size_t    type   {  };
+    };
+
+    template<class EntManager_t, std::size_t... I>
+    auto CreatePendingComponents(EntManager_t& ent_man,
+                                 std::index_sequence<I...>)
+    -> void
+    {
+        mPending.clear();
+        (PushPending(std::get<I>(mAttaches), I), ...);
+        std::sort(mPending.begin(), mPending.end(),
+                  [](const Pending_t& p1, const Pending_t& p2) {
+                      return p1.handle.index != p2.handle.index
+                             ? p1.handle.index < p2.handle.index
+                             : p1.handle.generation < p2.handle.generation;
+                  });
+
+        for (std::size_t p { 0 }; p < mPending.size();) {
+            const auto handle { mPending[p].handle };
+            typename EntManager_t::Signature_t sig {  };
+            for (; p < mPending.size() && mPending[p].handle == handle; ++p) {
+                sig.set(mPending[p].type);
+            }
+            if (auto ent { ent_man.GetEntityByHandle(handle) }) {
+                ent_man.CreateDefaultComponents(ent->get(), sig);
+            }
+        }
+    }
+
+    template<class Attaches_t>
+    auto PushPending(const Attaches_t& attaches, std::size_t type) -> void
+    {
+        for (const auto& attach : attaches) {
+            mPending.push_back({ Resolve(attach.first), type });
+        }
+    }
+
+    template<class ReqCmp_t, class EntManager_t>
+    auto FlushAttachesOfType(EntManager_t& ent_man) -> void
+    {
+        auto& attaches { std::get<Storage_t<Attach_t<ReqCmp_t>>>(mAttaches) };
+        if (attaches.empty()) {
+            return;
+        }
+
+        ent_man.template ReserveComponents<ReqCmp_t>(attaches.size());
+        for (auto& [target, cmp] : attaches) {
+            auto ent { ent_man.GetEntityByHandle(Resolve(target)) };
+            if (!ent) {
+                continue;
+            }
+            if (ent_man.template HasComponents<ReqCmp_t>(ent->get())) {
+                ent_man.template
+                SetRequieredComponent<ReqCmp_t>(ent->get(), std::move(cmp));
+            } else {
+                ent_man.template
+                CreateRequieredComponent<ReqCmp_t>(ent->get(), std::move(cmp));
+            }
+        }
+    }
+
+    template<class EntManager_t, std::size_t... I>
+    auto FlushDetaches(EntManager_t& ent_man, std::index_sequence<I...>)
+    -> void
+    {
+        (FlushDetachesOfType<Components_t, I>(ent_man), ...);
+    }
+
+    template<class ReqCmp_t, std::size_t I, class EntManager_t>
+    auto FlushDetachesOfType(EntManager_t& ent_man) -> void
+    {
+        for (auto& target : mDetaches[I]) {
+            if (auto ent { ent_man.GetEntityByHandle(Resolve(target)) }) {
+                ent_man.template RemoveRequieredComponent<ReqCmp_t>(ent->get());
+            }
+        }
+    }
+
+    std::uint32_t                           mCreatedCount    {  };
+    Storage_t<EntityHandle_t>               mCreated         {  };
+    Storage_t<Target_t>                     mRemovedEntities {  };
+    Storage_t<EntityHandle_t>               mRemovedHandles  {  };
+    Storage_t<Pending_t>                    mPending         {  };
+    Storage_t<EntityHandle_t>               mSlept           {  };
+    Storage_t<EntityHandle_t>               mWoken           {  };
+    Elements_t<Storage_t<Attach_t<Components_t>>...> mAttaches {  };
+    std::array<Storage_t<Target_t>,
+               sizeof...(Components_t)>     mDetaches        {  };
+};
+
+} // namespace ECS
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
 #include <ecs/util/type_aliases.hpp>
 #include <ecs/util/helpers.hpp>
+#include <ecs/cmp/soa_layout.hpp>
+#include <ecs/man/memory_report.hpp>
+#include <ecs/man/storage_policy.hpp>
 #include <vector>
 
 namespace ECS
@@ -18,9 +23,6 @@ struct ComponentVectorBase_t
 
     virtual EntityID_t
     RemoveComponentByIndex(ComponentID_t cmp_id) = 0;
-
-    virtual void
-    UpdateComponentEntityID(ComponentID_t cmp_id, EntityID_t eid) = 0;
 };
 
 template<class T>
@@ -42,29 +44,354 @@ struct VectorComponent_t final : public ComponentVectorBase_t
 
         return eid;
     }
+};
+
+// Sparse array indexed by entity with the index of its component in the
+// dense arrays of the pool
+struct SparseIndex_t
+{
+    constexpr static inline ComponentID_t npos { ~ComponentID_t{ 0 } };
+
+    Storage_t<ComponentID_t> mSparse {  };
 
     auto
-    UpdateComponentEntityID(ComponentID_t cmp_id, EntityID_t eid)
-    -> void override
+    FindComponentID(EntityID_t eid) const
+    -> Optional_t<ComponentID_t>
     {
-        auto index { static_cast<std::size_t>(cmp_id) };
-        mComponents[index].SetEntityID(eid);
+        Optional_t<ComponentID_t> cmp_id {  };
+
+        auto index { static_cast<std::size_t>(eid) };
+        if (index < mSparse.size() && mSparse[index] != npos) {
+            cmp_id.emplace(mSparse[index]);
+        }
+
+        return cmp_id;
+    }
+
+    auto
+    GetComponentID(EntityID_t eid) const
+    -> ComponentID_t
+    {
+        assert_msg(FindComponentID(eid), "The entity doesn't"
+                                         " have the component");
+        return mSparse[static_cast<std::size_t>(eid)];
+    }
+
+    auto
+    LinkComponentID(EntityID_t eid, ComponentID_t cmp_id)
+    -> void
+    {
+        auto index { static_cast<std::size_t>(eid) };
+        if (index >= mSparse.size()) {
+            mSparse.resize(index + 1, npos);
+        }
+        mSparse[index] = cmp_id;
+    }
+};
+
+// The rows [0, mAsleep) of a sparse set pool belong to entities that are
+// asleep and the rest to the awake ones, so the awake rows are one range. An
+// asleep row only moves when a row enters or leaves the asleep ones, the
+// pool counts both since it was made
+template<class Pool_t>
+struct AsleepRows_t
+{
+    std::size_t   mAsleep     {  };
+    std::uint64_t mSleptRows  {  };
+    std::uint64_t mWokenRows  {  };
+
+    auto SleepRow(std::size_t row) -> void
+    {
+        if (row >= mAsleep) {
+            Self().SwapRows(row, mAsleep++);
+            ++mSleptRows;
+        }
+    }
+
+    auto WakeRow(std::size_t row) -> void
+    {
+        if (row < mAsleep) {
+            Self().SwapRows(row, --mAsleep);
+            ++mWokenRows;
+        }
+    }
+
+    // The row to remove is moved to the awake rows first, so the removal
+    // only moves awake rows. Returns where the row is now
+    auto PrepareRemoveRow(std::size_t row) -> std::size_t
+    {
+        if (row < mAsleep) {
+            WakeRow(row);
+            return mAsleep;
+        }
+        return row;
+    }
+
+private:
+
+    auto Self() -> Pool_t& { return static_cast<Pool_t&>(*this); }
+};
+
+template<class T>
+struct SparseSetComponent_t final
+: public ComponentVectorBase_t,
+  public SparseIndex_t,
+  public AsleepRows_t<SparseSetComponent_t<T>>
+{
+    Storage_t<T> mComponents {  };
+
+    auto SwapRows(std::size_t row1, std::size_t row2) -> void
+    {
+        if (row1 == row2) {
+            return;
+        }
+        std::swap(mComponents[row1], mComponents[row2]);
+        const auto eid1 { mComponents[row1].GetEntityID() };
+        const auto eid2 { mComponents[row2].GetEntityID() };
+        mSparse[static_cast<std::size_t>(eid1)] = row1;
+        mSparse[static_cast<std::size_t>(eid2)] = row2;
+    }
+
+    auto
+    RemoveComponentByIndex(ComponentID_t cmp_id)
+    -> EntityID_t override
+    {
+        auto index
+        {
+            this->PrepareRemoveRow(static_cast<std::size_t>(cmp_id))
+        };
+        auto& last_cmp { mComponents.back() };
+        auto& rem_cmp  { mComponents[index] };
+        auto rem_eid  { rem_cmp.GetEntityID() };
+        auto last_eid { last_cmp.GetEntityID() };
+
+        if (&rem_cmp != &last_cmp) {
+            rem_cmp = std::move(last_cmp);
+            mSparse[static_cast<std::size_t>(last_eid)] = index;
+        }
+        mSparse[static_cast<std::size_t>(rem_eid)] = npos;
+        mComponents.pop_back();
+
+        return last_eid;
+    }
+
+    auto
+    RemoveComponentByEntity(EntityID_t eid)
+    -> void
+    {
+        if (auto cmp_id { FindComponentID(eid) }) {
+            RemoveComponentByIndex(*cmp_id);
+        }
+    }
+};
+
+// A row of a structure of arrays pool seen as an InternalComponent_t, the
+// component is a proxy to the fields of the row
+template<class Ref_t>
+struct SoARow_t
+{
+    constexpr auto GetEntityID() const -> EntityID_t { return EntityID; }
+
+    EntityID_t EntityID {  };
+    Ref_t      Self;
+};
+
+// Sparse set pool that keeps the entity IDs and every field declared in the
+// SoALayout_t of the component in their own contiguous array, so a loop only
+// brings to the cache the fields it touches
+template<class T>
+struct SoAComponent_t final : public ComponentVectorBase_t,
+                              public SparseIndex_t,
+                              public AsleepRows_t<SoAComponent_t<T>>
+{
+    using Layout_t   = SoALayout_t<T>;
+    using Ref_t      = typename Layout_t::Ref_t;
+    using ConstRef_t = typename Layout_t::ConstRef_t;
+    using Row_t      = SoARow_t<Ref_t>;
+    using ConstRow_t = SoARow_t<ConstRef_t>;
+    using Indexes_t  = std::make_index_sequence<SoAFieldCount<T>>;
+
+    template<std::size_t... I>
+    static auto MakeFields(std::index_sequence<I...>)
+    -> Elements_t<Storage_t<SoAField_t<T, I>>...>;
+
+    using Fields_t = decltype(MakeFields(Indexes_t{  }));
+
+    struct Iterator_t
+    {
+        auto operator*() const -> Row_t    { return (*pool)[row]; }
+        auto operator++() -> Iterator_t&   { ++row; return *this; }
+
+        constexpr auto operator!=(const Iterator_t& other) const -> bool
+        {
+            return row != other.row;
+        }
+
+        SoAComponent_t* pool {  };
+        std::size_t     row  {  };
+    };
+
+    auto begin() -> Iterator_t { return { this, 0 }; }
+    auto end()   -> Iterator_t { return { this, size() }; }
+
+    auto size() const -> std::size_t { return mEntities.size(); }
+
+    // The first field array, its rows are the ones to align the work to
+    auto data() const -> const SoAField_t<T, 0>*
+    {
+        return GetField<0>().data();
+    }
+
+    template<std::size_t I>
+    auto GetField() const -> const Storage_t<SoAField_t<T, I>>&
+    {
+        return std::get<I>(mFields);
+    }
+
+    template<std::size_t I>
+    auto GetField() -> Storage_t<SoAField_t<T, I>>&
+    {
+        return std::get<I>(mFields);
+    }
+
+    auto operator[](std::size_t row) const -> ConstRow_t
+    {
+        return { mEntities[row], GetRef(row) };
+    }
+
+    auto operator[](std::size_t row) -> Row_t
+    {
+        return { mEntities[row], GetRef(row) };
+    }
+
+    auto GetRef(std::size_t row) const -> ConstRef_t
+    {
+        return GetRefIMPL<ConstRef_t>(*this, row, Indexes_t{  });
+    }
+
+    auto GetRef(std::size_t row) -> Ref_t
+    {
+        return GetRefIMPL<Ref_t>(*this, row, Indexes_t{  });
+    }
+
+    auto PushBack(EntityID_t eid, T&& cmp) -> void
+    {
+        mEntities.push_back(eid);
+        PushBackIMPL(std::move(cmp), Indexes_t{  });
+    }
+
+    auto SetRow(std::size_t row, T&& cmp) -> void
+    {
+        SetRowIMPL(row, std::move(cmp), Indexes_t{  });
+    }
+
+    auto SwapRows(std::size_t row1, std::size_t row2) -> void
+    {
+        if (row1 == row2) {
+            return;
+        }
+        std::swap(mEntities[row1], mEntities[row2]);
+        std::apply([row1, row2](auto&... fields) {
+            (std::swap(fields[row1], fields[row2]), ...);
+        }, mFields);
+        mSparse[static_cast<std::size_t>(mEntities[row1])] = row1;
+        mSparse[static_cast<std::size_t>(mEntities[row2])] = row2;
+    }
+
+    auto Reserve(std::size_t n) -> void
+    {
+        ReserveMore(mEntities, n);
+        std::apply([n](auto&... fields) {
+            (ReserveMore(fields, n), ...);
+        }, mFields);
+    }
+
+    auto
+    RemoveComponentByIndex(ComponentID_t cmp_id)
+    -> EntityID_t override
+    {
+        auto index
+        {
+            this->PrepareRemoveRow(static_cast<std::size_t>(cmp_id))
+        };
+        auto rem_eid  { mEntities[index] };
+        auto last_eid { mEntities.back() };
+
+        if (index + 1 != size()) {
+            mEntities[index] = last_eid;
+            std::apply([index](auto&... fields) {
+                ((fields[index] = std::move(fields.back())), ...);
+            }, mFields);
+            mSparse[static_cast<std::size_t>(last_eid)] = index;
+        }
+        mSparse[static_cast<std::size_t>(rem_eid)] = npos;
+        mEntities.pop_back();
+        std::apply([](auto&... fields) {
+            (fields.pop_back(), ...);
+        }, mFields);
+
+        return last_eid;
+    }
+
+    auto
+    RemoveComponentByEntity(EntityID_t eid)
+    -> void
+    {
+        if (auto cmp_id { FindComponentID(eid) }) {
+            RemoveComponentByIndex(*cmp_id);
+        }
+    }
+
+    Storage_t<EntityID_t> mEntities {  };
+    Fields_t              mFields   {  };
+
+private:
+
+    template<class Proxy_t, class Self_t, std::size_t... I>
+    static auto GetRefIMPL(Self_t& self, std::size_t row,
+                           std::index_sequence<I...>)
+    -> Proxy_t
+    {
+        return Proxy_t{ std::get<I>(self.mFields)[row]... };
+    }
+
+    template<std::size_t... I>
+    auto PushBackIMPL(T&& cmp, std::index_sequence<I...>) -> void
+    {
+        (std::get<I>(mFields).push_back(
+                    std::move(cmp.*std::get<I>(Layout_t::Fields))), ...);
+    }
+
+    template<std::size_t... I>
+    auto SetRowIMPL(std::size_t row, T&& cmp, std::index_sequence<I...>)
+    -> void
+    {
+        ((std::get<I>(mFields)[row] =
+                    std::move(cmp.*std::get<I>(Layout_t::Fields))), ...);
     }
 };
 
 template<class EntMan_t> class ComponentStorage_t;
 
-template<template<class...> class EntMan_t,  class... Components_t>
-class ComponentStorage_t<EntMan_t<Components_t...>> final : Uncopyable_t
+template<template<class, class...> class EntMan_t,
+         class    StoragePolicy_t,
+         class... Components_t>
+class ComponentStorage_t<EntMan_t<StoragePolicy_t, Components_t...>> final
+: Uncopyable_t
 {
 
 public:
 
+    constexpr static inline bool IsSparseSet
+    {
+        StoragePolicyTraits_t<StoragePolicy_t>::IsSparseSet
+    };
+
     template<class EntID_t, class Component_t>
     struct InternalComponent_t final
     {
-        friend ComponentStorage_t<EntMan_t<Components_t...>>;
-        friend EntMan_t<Components_t...>;
+        friend ComponentStorage_t<EntMan_t<StoragePolicy_t, Components_t...>>;
+        friend EntMan_t<StoragePolicy_t, Components_t...>;
 
         using EntityID_type  = EntID_t;
         using Component_type = Component_t;
@@ -113,11 +440,38 @@ public:
     template<class T>
     using IComponent_t = InternalComponent_t<EntityID_t, T>;
 
+    // Only the sparse set pools split the fields of the SoA components
     template<class T>
-    using VecComponent_t = Storage_t<IComponent_t<T>>;
+    constexpr static inline bool IsSplit
+    {
+        IsSparseSet && IsSoA<RemovePCR<T>>
+    };
 
     template<class T>
-    using InternalVector_t = VectorComponent_t<IComponent_t<T>>; 
+    using VecComponent_t = std::conditional_t<IsSplit<T>,
+                                              SoAComponent_t<T>,
+                                              Storage_t<IComponent_t<T>>>;
+
+    template<class T>
+    using InternalVector_t = std::conditional_t<
+                                    IsSplit<T>,
+                                    SoAComponent_t<T>,
+                                    std::conditional_t<
+                                        IsSparseSet,
+                                        SparseSetComponent_t<IComponent_t<T>>,
+                                        VectorComponent_t<IComponent_t<T>>>>;
+
+    // A const T asks for the read only reference
+    template<class T>
+    using Ref_t = std::conditional_t<
+                    std::is_const_v<std::remove_reference_t<T>>,
+                    typename ComponentRefs_t<RemovePCR<T>,
+                                             IsSplit<T>>::ConstRef_t,
+                    typename ComponentRefs_t<RemovePCR<T>,
+                                             IsSplit<T>>::Ref_t>;
+
+    template<class T>
+    using ConstRef_t = Ref_t<const RemovePCR<T>>;
 
     using TableOfComponents_t = Elements_t<InternalVector_t<Components_t>...>;
 
@@ -129,24 +483,36 @@ public:
 
     template<typename ReqCmp_t, typename ...Args_t>
     constexpr auto
-    CreateRequieredComponentFromArgs(Args_t&& ...args)
-    -> Combine_t<ComponentID_t, ReqCmp_t&>
+    CreateRequieredComponentFromArgs(EntityID_t eid, Args_t&& ...args)
+    -> Combine_t<ComponentID_t, Ref_t<ReqCmp_t>>
     {
-        auto& vec_cmps { GetRequieredComponentStorage<ReqCmp_t>() };
-        auto cmp_id { vec_cmps.size() };
-        auto& cmp { vec_cmps.emplace_back(std::forward<Args_t>(args)...) };
-        return { cmp_id, cmp.Self };
+        auto& int_vec  { GetRequieredInternalVector<ReqCmp_t>() };
+        if constexpr (IsSplit<ReqCmp_t>) {
+            auto cmp_id { int_vec.size() };
+            int_vec.PushBack(eid, MakeComponent<ReqCmp_t>
+                                  (std::forward<Args_t>(args)...));
+            int_vec.LinkComponentID(eid, cmp_id);
+            return { cmp_id, int_vec.GetRef(cmp_id) };
+        } else {
+            auto& vec_cmps { int_vec.mComponents };
+            auto cmp_id { vec_cmps.size() };
+            auto& cmp { vec_cmps.emplace_back(std::forward<Args_t>(args)...) };
+            if constexpr (IsSparseSet) {
+                int_vec.LinkComponentID(eid, cmp_id);
+            }
+            return { cmp_id, cmp.Self };
+        }
     }
 
     template<typename ReqCmp_t, typename ...Args_t>
     constexpr auto
     CreateRequieredComponent(EntityID_t eid, Args_t&& ...args)
-    -> Combine_t<ComponentID_t, ReqCmp_t&>
+    -> Combine_t<ComponentID_t, Ref_t<ReqCmp_t>>
     {
         return
         CreateRequieredComponentFromArgs<ReqCmp_t>
         (
-         eid, std::forward<Args_t>(args)...
+         eid, eid, std::forward<Args_t>(args)...
         );
     }
 
@@ -154,7 +520,7 @@ public:
     template<typename... ReqCmps_t, typename... TupleArgs_t>
     constexpr auto
     CreateRequieredComponents(EntityID_t eid, TupleArgs_t&&... args)
-    -> Elements_t<Combine_t<ComponentID_t, ReqCmps_t&>...>
+    -> Elements_t<Combine_t<ComponentID_t, Ref_t<ReqCmps_t>>...>
     {
         if constexpr (sizeof...(TupleArgs_t) < sizeof...(ReqCmps_t))
         {
@@ -170,6 +536,7 @@ public:
             {
                 CreateRequieredComponentFromArgs<ReqCmps_t>
                 (
+                 eid,
                  std::piecewise_construct,
                  eid,
                  std::forward<TupleArgs_t>(args)
@@ -179,20 +546,223 @@ public:
     }
 
     constexpr auto
-    SetComponentEntityID(ComponentTypeID_t cmp_tp_id,
-                         ComponentID_t cmp_id,
-                         EntityID_t eid)
+    RemoveComponentByTypeIDAndID(ComponentTypeID_t cmp_tp_id,
+                                 ComponentID_t cmp_id)
+    -> EntityID_t
+    {
+        return mVecs[cmp_tp_id]->RemoveComponentByIndex(cmp_id);
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    FindComponentIDByEntity(EntityID_t eid) const
+    -> Optional_t<ComponentID_t>
+    {
+        static_assert(IsSparseSet, "Only the pools of a sparse set storage"
+                                   " know the entities of their components");
+        return GetRequieredInternalVector<ReqCmp_t>().FindComponentID(eid);
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetComponentIDByEntity(EntityID_t eid) const
+    -> ComponentID_t
+    {
+        static_assert(IsSparseSet, "Only the pools of a sparse set storage"
+                                   " know the entities of their components");
+        return GetRequieredInternalVector<ReqCmp_t>().GetComponentID(eid);
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredComponentByEntity(EntityID_t eid) const
+    -> ConstRef_t<ReqCmp_t>
+    {
+        const auto cmp_id { GetComponentIDByEntity<ReqCmp_t>(eid) };
+        if constexpr (IsSplit<ReqCmp_t>) {
+            return GetRequieredInternalVector<ReqCmp_t>().GetRef(cmp_id);
+        } else {
+            return GetRequieredComponentByID<RemovePCR<ReqCmp_t>>(cmp_id);
+        }
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredComponentByEntity(EntityID_t eid)
+    -> Ref_t<ReqCmp_t>
+    {
+        if constexpr (IsSplit<ReqCmp_t>) {
+            const auto cmp_id { GetComponentIDByEntity<ReqCmp_t>(eid) };
+            return GetRequieredInternalVector<ReqCmp_t>().GetRef(cmp_id);
+        } else {
+            return SameAsConstMemFunc
+                   (
+                    this,
+                    &ComponentStorage_t::template
+                    GetRequieredComponentByEntity<ReqCmp_t>,
+                    eid
+                   );
+        }
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    SetRequieredComponentByEntity(EntityID_t eid, RemovePCR<ReqCmp_t>&& cmp)
     -> void
     {
-        mVecs[cmp_tp_id]->UpdateComponentEntityID(cmp_id, eid);
+        if constexpr (IsSplit<ReqCmp_t>) {
+            GetRequieredInternalVector<ReqCmp_t>().SetRow(
+                            GetComponentIDByEntity<ReqCmp_t>(eid),
+                            std::move(cmp));
+        } else {
+            GetRequieredComponentByEntity<ReqCmp_t>(eid) = std::move(cmp);
+        }
     }
 
+    template<typename ReqCmp_t>
     constexpr auto
-    RemoveComponentByTypeIDAndID(ComponentTypeID_t cmp_tp_id,
-                                 ComponentID_t cmp_id)
-    -> EntityID_t
+    ReserveComponents(std::size_t n)
+    -> void
     {
-        return mVecs[cmp_tp_id]->RemoveComponentByIndex(cmp_id);
+        auto& int_vec { GetRequieredInternalVector<ReqCmp_t>() };
+        if constexpr (IsSplit<ReqCmp_t>) {
+            int_vec.Reserve(n);
+        } else {
+            ReserveMore(int_vec.mComponents, n);
+        }
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    RemoveComponentByEntity(EntityID_t eid)
+    -> void
+    {
+        GetRequieredInternalVector<ReqCmp_t>().RemoveComponentByEntity(eid);
+    }
+
+    constexpr auto
+    RemoveComponentsByEntity(EntityID_t eid)
+    -> void
+    {
+        ForEachInternalVector([eid](auto& int_vec) {
+            int_vec.RemoveComponentByEntity(eid);
+        });
+    }
+
+    // Each pool is walked once for all the entities, in their order, so it
+    // ends up the same as removing them one by one
+    template<class EntityIDs_t>
+    constexpr auto
+    RemoveComponentsByEntities(const EntityIDs_t& eids)
+    -> void
+    {
+        ForEachInternalVector([&eids](auto& int_vec) {
+            for (const auto eid : eids) {
+                int_vec.RemoveComponentByEntity(eid);
+            }
+        });
+    }
+
+    auto
+    SleepComponentsByEntity(EntityID_t eid)
+    -> void
+    {
+        static_assert(IsSparseSet, "Only the sparse set pools keep the rows"
+                                   " of the entities asleep apart");
+        ForEachInternalVector([eid](auto& int_vec) {
+            if (auto cmp_id { int_vec.FindComponentID(eid) }) {
+                int_vec.SleepRow(*cmp_id);
+            }
+        });
+    }
+
+    auto
+    WakeComponentsByEntity(EntityID_t eid)
+    -> void
+    {
+        static_assert(IsSparseSet, "Only the sparse set pools keep the rows"
+                                   " of the entities asleep apart");
+        ForEachInternalVector([eid](auto& int_vec) {
+            if (auto cmp_id { int_vec.FindComponentID(eid) }) {
+                int_vec.WakeRow(*cmp_id);
+            }
+        });
+    }
+
+    // The rows [0, count) of the pool are asleep
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetAsleepCount() const
+    -> std::size_t
+    {
+        if constexpr (IsSparseSet) {
+            return GetRequieredInternalVector<ReqCmp_t>().mAsleep;
+        } else {
+            return 0;
+        }
+    }
+
+    // The rows that entered and left the asleep rows of the pool so far, a
+    // removed asleep row leaves them first
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetAsleepChanges() const
+    -> Combine_t<std::uint64_t, std::uint64_t>
+    {
+        if constexpr (IsSparseSet) {
+            const auto& int_vec { GetRequieredInternalVector<ReqCmp_t>() };
+            return { int_vec.mSleptRows, int_vec.mWokenRows };
+        } else {
+            return { 0, 0 };
+        }
+    }
+
+    // A split pool has no padding, each field is in its own array, and its
+    // capacity is the one of the shortest array
+    template<typename ReqCmp_t>
+    auto
+    GetPoolMemory() const
+    -> PoolMemory_t
+    {
+        using Cmp_t = RemovePCR<ReqCmp_t>;
+        const auto& int_vec { GetRequieredInternalVector<Cmp_t>() };
+
+        PoolMemory_t pool { TypeName<Cmp_t>() };
+        if constexpr (IsSplit<Cmp_t>) {
+            pool.count     = int_vec.size();
+            pool.capacity  = int_vec.mEntities.capacity();
+            pool.row_bytes = sizeof(EntityID_t);
+            std::apply([&pool](const auto&... fields) {
+                ((pool.row_bytes += sizeof(typename std::decay_t<
+                                          decltype(fields)>::value_type),
+                  pool.capacity   = std::min(pool.capacity,
+                                             fields.capacity())), ...);
+            }, int_vec.mFields);
+        } else {
+            const auto& rows { int_vec.mComponents };
+            pool.count     = rows.size();
+            pool.capacity  = rows.capacity();
+            pool.row_bytes = sizeof(IComponent_t<Cmp_t>);
+            pool.padding   = sizeof(IComponent_t<Cmp_t>)
+                           - sizeof(EntityID_t) - sizeof(Cmp_t);
+            for (const auto& row : rows) {
+                pool.heap_bytes += ComponentHeapBytes(row.Self);
+            }
+        }
+        if constexpr (IsSparseSet) {
+            pool.index_slots = int_vec.mSparse.size();
+            pool.index_bytes = int_vec.mSparse.capacity()
+                             * sizeof(ComponentID_t);
+        }
+        return pool;
+    }
+
+    // Every byte is in the pools
+    constexpr auto
+    GetStorageBytes() const
+    -> std::size_t
+    {
+        return 0;
     }
 
     template<typename ReqCmp_t>
@@ -210,17 +780,39 @@ public:
 
     template<typename ReqCmp_t>
     constexpr auto
-    GetRequieredComponentStorage() const
-    -> const VecComponent_t<RemovePCR<ReqCmp_t>>&
+    GetRequieredInternalVector() const
+    -> const InternalVector_t<RemovePCR<ReqCmp_t>>&
     {
         CheckIfComponentIsInThisInstance<RemovePCR<ReqCmp_t>>();
 
-        auto& vec_cmps
-        {
-            std::get<InternalVector_t<RemovePCR<ReqCmp_t>>>(mComponentVectors)
-        };
+        return
+        std::get<InternalVector_t<RemovePCR<ReqCmp_t>>>(mComponentVectors);
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredInternalVector()
+    -> InternalVector_t<RemovePCR<ReqCmp_t>>&
+    {
+        return SameAsConstMemFunc
+               (
+                this,
+                &ComponentStorage_t::template
+                GetRequieredInternalVector<ReqCmp_t>
+               );
+    }
 
-        return vec_cmps.mComponents;
+    // The SoA pools are their own storage, they are iterated by rows
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetRequieredComponentStorage() const
+    -> const VecComponent_t<RemovePCR<ReqCmp_t>>&
+    {
+        if constexpr (IsSplit<ReqCmp_t>) {
+            return GetRequieredInternalVector<ReqCmp_t>();
+        } else {
+            return GetRequieredInternalVector<ReqCmp_t>().mComponents;
+        }
     }
 
     template<typename ReqCmp_t>
@@ -262,6 +854,26 @@ public:
 
 private:
 
+    template<class ReqCmp_t, class EID_t, class... Args_t>
+    static constexpr auto
+    MakeComponent(EID_t&&, Args_t&&... args)
+    -> RemovePCR<ReqCmp_t>
+    {
+        return RemovePCR<ReqCmp_t>{ std::forward<Args_t>(args)... };
+    }
+
+    template<class ReqCmp_t, class EID_t, class TupleArgs_t>
+    static constexpr auto
+    MakeComponent(std::piecewise_construct_t, EID_t&&, TupleArgs_t&& args)
+    -> RemovePCR<ReqCmp_t>
+    {
+        return
+        std::apply([](auto&&... cmp_args) {
+            return RemovePCR<ReqCmp_t>{
+                        std::forward<decltype(cmp_args)>(cmp_args)... };
+        }, std::forward<TupleArgs_t>(args));
+    }
+
     template<typename ReqCmp_t>
     static constexpr auto CheckIfComponentIsInThisInstance() -> void
     {
@@ -276,6 +888,14 @@ private:
                       "Components need to be unique");
     }
 
+    template<class Callable_t>
+    constexpr auto ForEachInternalVector(Callable_t&& callable) -> void
+    {
+        std::apply([&callable](auto&... int_vecs) {
+            (callable(int_vecs), ...);
+        }, mComponentVectors);
+    }
+
     template<std::size_t I = 0>
     constexpr auto InitVecsPtr() -> void
     {
@@ -1,23 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <deque>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
-#include <queue>
 
+#include "archetype_storage.hpp"
+#include "command_buffer.hpp"
 #include "component_storage.hpp"
+#include "memory_report.hpp"
+#include "storage_policy.hpp"
+#include "system_scheduler.hpp"
+#include "view.hpp"
 
 #include <ecs/util/type_aliases.hpp>
+#include <ecs/util/alloc_tracker.hpp>
 #include <ecs/util/helpers.hpp>
+#include <ecs/util/profiler.hpp>
+#include <ecs/util/thread_pool.hpp>
 #include <ecs/cmp/entity.hpp>
 #include <tmp/type_list.hpp>
 
 //TODO vector of entities for systems
 //TODO create unique types for ComponentTypeID, ComponentID, EntityID_t
-/*TODO for enhanced loop
- * iterator tat returns a tuple with components 
- */
 namespace ECS
 {
 
@@ -31,37 +40,245 @@ struct ComponentExtractorHelper_t
     operator()(EntManager_t&& ent_man, Callable_t&& callable) -> void
     {
         ent_man.template
-        DoForEachComponentTypeIMPL<MainComponent_t,
-                                   ExtraComponents_t...>
+        DoForEachComponentTypeIMPL<RemovePCR<MainComponent_t>,
+                                   RemovePCR<ExtraComponents_t>...>
                                    (std::forward<EntManager_t>(ent_man),
                                     std::forward<Callable_t>(callable));
     }
 };
 
-template<class... Components_t>
-class EntityManager_t
+template<class StoragePolicy_t, class... Components_t>
+class BasicEntityManager_t
 {
 
 public:
 
-    using Self_t = EntityManager_t<Components_t...>;
-    using SelfComponentStorage_t = ComponentStorage_t<Self_t>;
-    using OwnEntity_t = Entity_t<Self_t>;
+    using Self_t = BasicEntityManager_t<StoragePolicy_t, Components_t...>;
+    using SelfComponentStorage_t = std::conditional_t<
+                                    StoragePolicyTraits_t
+                                    <StoragePolicy_t>::IsArchetype,
+                                    ArchetypeComponentStorage_t<Self_t>,
+                                    ComponentStorage_t<Self_t>>;
+    using Signature_t = std::bitset<sizeof...(Components_t)>;
+    using OwnEntity_t = Entity_t<Self_t,
+                                 Signature_t,
+                                 typename StoragePolicyTraits_t
+                                 <StoragePolicy_t>::EntityBase_type>;
     using VecEntity_t = Storage_t<OwnEntity_t>;
+    using SelfCommandBuffer_t = CommandBuffer_t<Self_t>;
+
+    template<class... ReqCmps_t>
+    using View_t = std::conditional_t<
+                            StoragePolicyTraits_t<StoragePolicy_t>::IsArchetype,
+                            ArchetypeView_t<Self_t, ReqCmps_t...>,
+                            PoolView_t<Self_t, ReqCmps_t...>>;
 
     template<class T>
     using VecComponent_t = typename SelfComponentStorage_t::
                            template VecComponent_t<T>;
 
-    constexpr explicit EntityManager_t() = default;
+    // T& for most components, the proxy of its SoALayout_t when the storage
+    // splits the fields of T
+    template<class T>
+    using ComponentRef_t = typename SelfComponentStorage_t::
+                           template Ref_t<T>;
+
+    template<class T>
+    using ConstComponentRef_t = typename SelfComponentStorage_t::
+                                template ConstRef_t<T>;
+
+    template<class T>
+    using NullableComponent_t = std::conditional_t<
+                                    std::is_reference_v<ComponentRef_t<T>>,
+                                    Nullable_t<T>,
+                                    Optional_t<ComponentRef_t<T>>>;
+
+    constexpr static inline bool IsSparseSet
+    {
+        StoragePolicyTraits_t<StoragePolicy_t>::IsSparseSet
+    };
+
+    constexpr static inline bool IsArchetype
+    {
+        StoragePolicyTraits_t<StoragePolicy_t>::IsArchetype
+    };
+
+    // The pool of T keeps each field of T in its own array
+    template<class T>
+    constexpr static inline bool IsSplit
+    {
+        SelfComponentStorage_t::template IsSplit<T>
+    };
+
+    // Only the entity map policy keeps the components IDs inside the entity,
+    // the other policies find them from the entity ID
+    constexpr static inline bool IsEntityMap { !IsSparseSet && !IsArchetype };
+
+    // For the systems that work with managers without some component
+    template<class ReqCmp_t>
+    constexpr static inline bool HasComponentType
+    {
+        IsOneOf<RemovePCR<ReqCmp_t>, Components_t...>::value
+    };
+
+    // Rows of the main component given to each task of ParallelForEach
+    constexpr static inline std::size_t DefaultGrain { 4096 };
+
+    constexpr explicit BasicEntityManager_t()
+    {
+        static_assert(sizeof...(Components_t) <= 64,
+                      "The signature of the components is built from a"
+                      " 64 bits mask");
+    }
+
+    template<class... ReqCmps_t>
+    static constexpr auto
+    GetSignature() -> Signature_t
+    {
+        return Signature_t
+        {
+            (0ULL | ... | (1ULL << SelfComponentStorage_t::template
+                                   GetRequiredComponentTypeID<ReqCmps_t>()))
+        };
+    }
+
+    template<template<class...> class TList_t, class... ReqCmps_t>
+    static constexpr auto
+    GetSignature(TList_t<ReqCmps_t...>) -> Signature_t
+    {
+        return GetSignature<ReqCmps_t...>();
+    }
+
+    template<class... ReqCmps_t>
+    auto HasComponents(const OwnEntity_t& ent) const -> bool
+    {
+        constexpr Signature_t sig { GetSignature<ReqCmps_t...>() };
+        return ent.HasSignature(sig);
+    }
+
+    // Range of the entities with all the ReqCmps_t components, usable in a
+    // range-for with structured bindings: [cmps..., ent]
+    template<class... ReqCmps_t>
+    auto View() -> View_t<RemovePCR<ReqCmps_t>...>
+    {
+        if constexpr (IsArchetype) {
+            return View_t<RemovePCR<ReqCmps_t>...>{ *this,
+                                                    mComponents.GetTables() };
+        } else {
+            return View_t<RemovePCR<ReqCmps_t>...>{ *this };
+        }
+    }
+
+    template<class SysSignature_t, class Callable_t>
+    auto ForEachMatchingEntity(Callable_t&& callable) -> void
+    {
+        constexpr Signature_t sig { GetSignature(SysSignature_t{  }) };
+        for (auto& ent : mEntities) {
+            if (ent.IsAlive() && ent.HasSignature(sig)) {
+                std::invoke(callable, ent);
+            }
+        }
+    }
 
+    // The slot of a removed entity is reused, it keeps the generation that
+    // RemoveEntity gave it so the handles of the old entity stay stale
     auto CreateEntity() -> OwnEntity_t&
     {
-        const auto ent_id { mEntities.size() };
+        if (!mDeadEntities.empty()) {
+            const auto ent_id { mDeadEntities.back() };
+            mDeadEntities.pop_back();
+            auto& ent { GetEntityByID(ent_id) };
+            ent.m_ID = ent_id;
+            return ent;
+        }
+
+        const auto ent_id { static_cast<EntityID_t>(mEntities.size()) };
         mEntities.push_back(OwnEntity_t{ ent_id });
+        // Every slot can die, removing entities never grows the lists
+        ReserveAtLeast(mDeadEntities, mEntities.capacity());
+        ReserveAtLeast(mRemovedIDs, mEntities.capacity());
         return mEntities.back();
     }
 
+    constexpr auto IsAlive(EntityHandle_t handle) const -> bool
+    {
+        const auto index { static_cast<std::size_t>(handle.index) };
+        return index < mEntities.size()
+            && mEntities[index].m_Generation == handle.generation;
+    }
+
+    auto GetEntityByHandle(EntityHandle_t handle) const
+    -> Nullable_t<const OwnEntity_t>
+    {
+        Nullable_t<const OwnEntity_t> ent {  };
+        if (IsAlive(handle)) {
+            ent.emplace(GetEntityByID(handle.index));
+        }
+        return ent;
+    }
+
+    auto GetEntityByHandle(EntityHandle_t handle)
+    -> Nullable_t<OwnEntity_t>
+    {
+        Nullable_t<OwnEntity_t> ent {  };
+        if (IsAlive(handle)) {
+            ent.emplace(GetEntityByID(handle.index));
+        }
+        return ent;
+    }
+
+    auto ReserveEntities(std::size_t n) -> void
+    {
+        if (n > mDeadEntities.size()) {
+            ReserveMore(mEntities, n - mDeadEntities.size());
+        }
+    }
+
+    template<class ReqCmp_t>
+    auto ReserveComponents(std::size_t n) -> void
+    {
+        mComponents.template ReserveComponents<RemovePCR<ReqCmp_t>>(n);
+    }
+
+    // Structural changes requested while iterating the components are
+    // recorded here and applied by FlushCommandBuffer at a sync point. Inside
+    // a RecorderScope_t the buffer is the one of that recorder
+    auto GetCommandBuffer() -> SelfCommandBuffer_t&
+    {
+        return tRecorder == 0 ? mCommands : mRecorders[tRecorder - 1];
+    }
+
+    // Recorders 1 to count get a buffer each, it must be called before they
+    // record, not while they do
+    auto ReserveRecorders(std::size_t count) -> void
+    {
+        while (mRecorders.size() < count) {
+            mRecorders.emplace_back();
+        }
+    }
+
+    // The buffers of the recorders are merged in the order of the recorders
+    // after the one of the manager, so the result doesn't depend on which
+    // of them recorded first
+    auto FlushCommandBuffer() -> void
+    {
+        ECS_PROFILE_SCOPE("FlushCommandBuffer");
+        ECS_ALLOC_SCOPE("FlushCommandBuffer");
+        for (auto& recorder : mRecorders) {
+            mCommands.Append(recorder);
+        }
+        mCommands.Flush(*this);
+        for (auto& recorder : mRecorders) {
+            recorder.Reserve(GetAliveEntitiesCount());
+        }
+    }
+
+    auto GetAliveEntitiesCount() const -> std::size_t
+    {
+        return mEntities.size() - mDeadEntities.size();
+    }
+
+    // The slots of the removed entities are kept, check IsAlive() on them
     auto GetEntities() const -> const VecEntity_t&
     {
         return mEntities;
@@ -69,7 +286,33 @@ public:
 
     auto GetEntities() -> VecEntity_t&
     {
-        return SameAsConstMemFunc(this, &EntityManager_t::GetEntities);
+        return SameAsConstMemFunc(this, &BasicEntityManager_t::GetEntities);
+    }
+
+    using SelfMemoryReport_t = MemoryReport_t<sizeof...(Components_t)>;
+
+    // Walks every pool and every entity slot, it's meant for a summary every
+    // few hundred frames or after a mass removal, not for every frame
+    auto GetMemoryReport() const -> SelfMemoryReport_t
+    {
+        SelfMemoryReport_t report {
+            { mComponents.template GetPoolMemory<Components_t>()... }
+        };
+        report.entities        = GetAliveEntitiesCount();
+        report.entity_slots    = mEntities.size();
+        report.entity_capacity = mEntities.capacity();
+        report.entity_bytes    = sizeof(OwnEntity_t);
+        for (const auto& ent : mEntities) {
+            report.entity_map_bytes += ent.GetHeapBytes();
+        }
+        report.storage_bytes = mComponents.GetStorageBytes()
+                             + mDeadEntities.capacity() * sizeof(EntityID_t)
+                             + mRemovedIDs.capacity() * sizeof(EntityID_t);
+        report.command_bytes = mCommands.GetReservedBytes();
+        for (const auto& recorder : mRecorders) {
+            report.command_bytes += recorder.GetReservedBytes();
+        }
+        return report;
     }
 
     auto GetEntityByID(EntityID_t ent_id) const -> const OwnEntity_t&
@@ -80,42 +323,156 @@ public:
     auto GetEntityByID(EntityID_t ent_id) -> OwnEntity_t&
     {
         return SameAsConstMemFunc(this,
-                                  &EntityManager_t::GetEntityByID,
+                                  &BasicEntityManager_t::GetEntityByID,
                                   ent_id);
     }
 
     constexpr auto
     RemoveComponentsFromEntity(OwnEntity_t& e) -> void
     {
-        for (auto& [cmp_tp_id, cmp_id] : e) {
-            auto eid { mComponents.RemoveComponentByTypeIDAndID(cmp_tp_id,
-                                                                cmp_id) };
-            auto& ent_upd { GetEntityByID(eid) };
-            ent_upd.UpdateComponentID(cmp_tp_id, cmp_id);
+        e.m_Signature.reset();
+        if constexpr (!IsEntityMap) {
+            mComponents.RemoveComponentsByEntity(e.GetEntityID());
+        } else {
+            for (auto& [cmp_tp_id, cmp_id] : e) {
+                auto eid { mComponents.RemoveComponentByTypeIDAndID(cmp_tp_id,
+                                                                    cmp_id) };
+                auto& ent_upd { GetEntityByID(eid) };
+                ent_upd.UpdateComponentID(cmp_tp_id, cmp_id);
+            }
         }
     }
 
+    // Only the components of the entity are touched, the slot is marked as
+    // dead and its generation is bumped so every handle to it becomes stale
     constexpr auto
-    UpdateComponentsEntityIDFromEntity(OwnEntity_t& ent, EntityID_t new_id)
-    -> void
+    RemoveEntity(const OwnEntity_t& e) -> void
+    {
+        const auto ent_id { e.GetEntityID() };
+        assert_msg(ent_id != InvalidEntityID, "The entity is already dead");
+
+        auto& ent { GetEntityByID(ent_id) };
+        RemoveComponentsFromEntity(ent);
+        FreeEntitySlot(ent);
+    }
+
+    auto RemoveEntity(EntityHandle_t handle) -> void
     {
-        for (auto& [cmp_tp_id, cmp_id] : ent) {
-            mComponents.SetComponentEntityID(cmp_tp_id,
-                                             cmp_id,
-                                             new_id);
+        if (IsAlive(handle)) {
+            RemoveEntity(GetEntityByID(handle.index));
         }
     }
 
-    //TODO: add markedAsDead for prevent the last_entity don't being updated
-    constexpr auto
-    RemoveEntity(const OwnEntity_t& e) -> void
+    // Sorts the handles and removes their entities at once, the stale and
+    // repeated handles are skipped. With the sparse set pools every pool is
+    // walked once for all of them, in the order of their slots
+    auto RemoveEntities(Storage_t<EntityHandle_t>& handles) -> void
     {
+        std::sort(handles.begin(), handles.end(),
+                  [](EntityHandle_t h1, EntityHandle_t h2) {
+                      return h1.index < h2.index;
+                  });
+        mRemovedIDs.clear();
+        for (const auto handle : handles) {
+            if (IsAlive(handle) && (mRemovedIDs.empty()
+                                    || mRemovedIDs.back() != handle.index)) {
+                mRemovedIDs.push_back(handle.index);
+            }
+        }
+
+        if constexpr (IsSparseSet) {
+            mComponents.RemoveComponentsByEntities(mRemovedIDs);
+        }
+        for (const auto ent_id : mRemovedIDs) {
+            auto& ent { GetEntityByID(ent_id) };
+            if constexpr (IsSparseSet) {
+                ent.m_Signature.reset();
+            } else {
+                RemoveComponentsFromEntity(ent);
+            }
+            FreeEntitySlot(ent);
+        }
+    }
+
+    // The components of an entity asleep are moved to the front of their
+    // pools, after them come the awake ones, so the systems that only care
+    // about what moves walk one contiguous range. Creating, setting or
+    // removing a component through the manager wakes the entity, a write
+    // through a reference the manager gave out needs a Wake. Both move rows
+    // of the pools, so while they are iterated use the command buffer
+    auto Sleep(const OwnEntity_t& e) -> void
+    {
+        static_assert(IsSparseSet, "Only the sparse set pools keep the"
+                                   " entities asleep apart");
+
         auto& ent { GetEntityByID(e.GetEntityID()) };
-        auto& last_entity { GetEntities().back() };
-        RemoveComponentsFromEntity(ent);
-        UpdateComponentsEntityIDFromEntity(last_entity, e.GetEntityID());
-        ent = last_entity;
-        GetEntities().pop_back();
+        if (ent.m_Awake) {
+            mComponents.SleepComponentsByEntity(ent.GetEntityID());
+            ent.m_Awake = false;
+        }
+    }
+
+    // With the other storage policies every entity is always awake
+    auto Wake(const OwnEntity_t& e) -> void
+    {
+        if constexpr (IsSparseSet) {
+            auto& ent { GetEntityByID(e.GetEntityID()) };
+            if (!ent.m_Awake) {
+                mComponents.WakeComponentsByEntity(ent.GetEntityID());
+                ent.m_Awake = true;
+            }
+        }
+    }
+
+    auto Sleep(EntityHandle_t handle) -> void
+    {
+        if (IsAlive(handle)) {
+            Sleep(GetEntityByID(handle.index));
+        }
+    }
+
+    auto Wake(EntityHandle_t handle) -> void
+    {
+        if (IsAlive(handle)) {
+            Wake(GetEntityByID(handle.index));
+        }
+    }
+
+    // The rows [0, count) of the pool of ReqCmp_t are the asleep ones
+    template<class ReqCmp_t>
+    auto GetAsleepCount() const -> std::size_t
+    {
+        if constexpr (IsSparseSet) {
+            return mComponents.template
+                   GetAsleepCount<RemovePCR<ReqCmp_t>>();
+        } else {
+            return 0;
+        }
+    }
+
+    // Row of the component of the entity in the pool of ReqCmp_t, the
+    // entity is asleep if it is below the asleep count
+    template<class ReqCmp_t>
+    auto GetRow(const OwnEntity_t& ent) const -> std::size_t
+    {
+        static_assert(IsSparseSet, "Only the pools of a sparse set storage"
+                                   " have rows");
+        return mComponents.template
+               GetComponentIDByEntity<RemovePCR<ReqCmp_t>>(ent.GetEntityID());
+    }
+
+    // How many rows entered and how many left the asleep rows of the pool
+    // of ReqCmp_t so far, what is computed from the asleep rows stays valid
+    // while both stay the same
+    template<class ReqCmp_t>
+    auto GetAsleepChanges() const -> Combine_t<std::uint64_t, std::uint64_t>
+    {
+        if constexpr (IsSparseSet) {
+            return mComponents.template
+                   GetAsleepChanges<RemovePCR<ReqCmp_t>>();
+        } else {
+            return { 0, 0 };
+        }
     }
 
     template<typename InternalComponent_t>
@@ -132,7 +489,7 @@ public:
     -> OwnEntity_t&
     {
         return SameAsConstMemFunc(this,
-                                  &EntityManager_t::template
+                                  &BasicEntityManager_t::template
                                   GetEntityByComponent<InternalComponent_t>,
                                   in_cmp);
     }
@@ -154,33 +511,84 @@ public:
         return SameAsConstMemFunc
                (
                  this,
-                 &EntityManager_t::
+                 &BasicEntityManager_t::
                  GetRequieredComponentStorage<ReqCmp_t>
                );
     }
 
-    template<class ID_Cmp_t>
+    template<class ReqCmp_t, class ID_Cmp_t>
     constexpr auto
     AttachComponentToEntity(OwnEntity_t& ent,
                             ID_Cmp_t id_cmp)
-    -> typename ID_Cmp_t::second_type&
+    -> ComponentRef_t<ReqCmp_t>
     {
-        auto [cmp_id, cmp] { id_cmp };
+        const auto cmp_id { id_cmp.first };
         const auto cmp_tp_id
         {
-            mComponents.template
-            GetRequiredComponentTypeID<typename ID_Cmp_t::second_type>()
+            mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
+        };
+        ent.m_Signature.set(cmp_tp_id);
+        if constexpr (IsEntityMap) {
+            ent.AttachComponentID(cmp_tp_id, cmp_id);
+        }
+        return id_cmp.second;
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    RemoveRequieredComponent(OwnEntity_t& ent) -> void
+    {
+        const auto cmp_tp_id
+        {
+            mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
         };
-        ent.AttachComponentID(cmp_tp_id, cmp_id);
-        return cmp;
+        if (!ent.GetSignature().test(cmp_tp_id)) {
+            return;
+        }
+
+        Wake(ent);
+        ent.m_Signature.reset(cmp_tp_id);
+        if constexpr (!IsEntityMap) {
+            mComponents.template
+            RemoveComponentByEntity<ReqCmp_t>(ent.GetEntityID());
+        } else {
+            const auto cmp_id { ent.GetRequiredComponentID(cmp_tp_id) };
+            ent.DetachComponentID(cmp_tp_id);
+            auto eid { mComponents.RemoveComponentByTypeIDAndID(cmp_tp_id,
+                                                                cmp_id) };
+            if (eid != ent.GetEntityID()) {
+                GetEntityByID(eid).UpdateComponentID(cmp_tp_id, cmp_id);
+            }
+        }
+    }
+
+    // The entity gets a default component of every type in sig that it
+    // doesn't have, with the archetype storage it's moved only once, to
+    // the table of its final signature. The components set afterwards are
+    // assigned in place
+    auto CreateDefaultComponents(OwnEntity_t& ent, Signature_t sig) -> void
+    {
+        static_assert(IsArchetype, "Only the archetype storage moves the"
+                                   " entities between tables");
+        mComponents.CreateDefaultComponentsByEntity(ent.GetEntityID(), sig);
+        ent.m_Signature |= sig;
     }
 
-    //FIXME: What happens when the entity already has the ReqCmp_t component
+    // A component the entity already has is assigned over, a second row
+    // would be visited twice and outlive the entity
     template<typename ReqCmp_t, typename ...Args_t>
     constexpr
     auto CreateRequieredComponent(OwnEntity_t& ent, Args_t&& ...args)
-    -> ReqCmp_t&
+    -> ComponentRef_t<ReqCmp_t>
     {
+        if constexpr (!IsArchetype) {
+            if (HasComponents<ReqCmp_t>(ent)) {
+                SetRequieredComponent<ReqCmp_t>(
+                    ent, RemovePCR<ReqCmp_t>{ std::forward<Args_t>(args)... });
+                return GetRequieredComponent<ReqCmp_t>(ent);
+            }
+        }
+        Wake(ent);
         auto id_cmp
         {
             mComponents.template
@@ -191,7 +599,7 @@ public:
             )
         };
 
-        return AttachComponentToEntity(ent, id_cmp);
+        return AttachComponentToEntity<ReqCmp_t>(ent, id_cmp);
     }
 
     template<class... ReqCmps_t,
@@ -201,11 +609,11 @@ public:
     CreateRequieredComponentsIMPL(OwnEntity_t& ent,
                                   TupleCmps_t&& cmps,
                                   std::index_sequence<I...>)
-    -> Elements_t<ReqCmps_t&...>
+    -> Elements_t<ComponentRef_t<ReqCmps_t>...>
     {
         return
         {
-            AttachComponentToEntity
+            AttachComponentToEntity<ReqCmps_t>
             (
              ent,
              std::get<I>(std::forward<TupleCmps_t>(cmps))
@@ -216,8 +624,21 @@ public:
     template<class... ReqCmps_t, class... TupleArgs_t>
     constexpr auto
     CreateRequieredComponents(OwnEntity_t& ent, TupleArgs_t&&... args)
-    -> Elements_t<ReqCmps_t&...>
+    -> Elements_t<ComponentRef_t<ReqCmps_t>...>
     {
+        if constexpr (!IsArchetype) {
+            if ((HasComponents<ReqCmps_t>(ent) || ...)) {
+                return
+                {
+                    std::apply([this, &ent](auto&&... cmp_args)
+                               -> ComponentRef_t<ReqCmps_t> {
+                        return CreateRequieredComponent<ReqCmps_t>(
+                            ent, std::forward<decltype(cmp_args)>(cmp_args)...);
+                    }, std::forward<TupleArgs_t>(args))...
+                };
+            }
+        }
+        Wake(ent);
         auto cmps
         {
             mComponents.template
@@ -236,29 +657,57 @@ public:
         return CreateRequieredComponentsIMPL<ReqCmps_t...>(ent, cmps, indexes);
     }
 
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetComponentFromStorage(const OwnEntity_t& ent) const
+    -> ConstComponentRef_t<ReqCmp_t>
+    {
+        if constexpr (IsEntityMap) {
+            const auto cmp_tp_id
+            {
+                mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
+            };
+            return mComponents.template
+                   GetRequieredComponentByID<RemovePCR<ReqCmp_t>>
+                   (ent.GetRequiredComponentID(cmp_tp_id));
+        } else {
+            return mComponents.template
+                   GetRequieredComponentByEntity<ReqCmp_t>(ent.GetEntityID());
+        }
+    }
+
+    template<typename ReqCmp_t>
+    constexpr auto
+    GetComponentFromStorage(const OwnEntity_t& ent)
+    -> ComponentRef_t<ReqCmp_t>
+    {
+        if constexpr (IsEntityMap) {
+            const auto cmp_tp_id
+            {
+                mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
+            };
+            return mComponents.template
+                   GetRequieredComponentByID<RemovePCR<ReqCmp_t>>
+                   (ent.GetRequiredComponentID(cmp_tp_id));
+        } else {
+            return mComponents.template
+                   GetRequieredComponentByEntity<ReqCmp_t>(ent.GetEntityID());
+        }
+    }
+
     template<typename ReqCmp_t>
     constexpr auto
     GetOptionalComponent(const OwnEntity_t& ent)
-    -> Nullable_t<ReqCmp_t>
+    -> NullableComponent_t<ReqCmp_t>
     {
         const auto cmp_tp_id
         {
             mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
         };
 
-        const auto cmp_id
-        {
-            ent.FindRequiredComponentID(cmp_tp_id)
-        };
-
-        Nullable_t<ReqCmp_t> optional_cmp {  };
-        if (cmp_id) {
-            auto& cmp
-            {
-                mComponents.template
-                GetRequieredComponentByID<ReqCmp_t>(*cmp_id)
-            };
-            optional_cmp.emplace(cmp);
+        NullableComponent_t<ReqCmp_t> optional_cmp {  };
+        if (ent.GetSignature().test(cmp_tp_id)) {
+            optional_cmp.emplace(GetComponentFromStorage<ReqCmp_t>(ent));
         }
 
         return optional_cmp;
@@ -267,7 +716,7 @@ public:
     template<typename ReqCmp_t>
     constexpr auto
     GetOptionalComponent(const OwnEntity_t& ent) const
-    -> const Nullable_t<const ReqCmp_t>
+    -> const NullableComponent_t<const ReqCmp_t>
     {
         return
         const_cast<Self_t*>(this)->GetOptionalComponent<const ReqCmp_t>(ent);
@@ -296,20 +745,9 @@ public:
                                        Components_t...>::value, bool> = true>
     constexpr auto
     GetRequieredComponent(const OwnEntity_t& ent) const
-    -> const ReqCmp_t&
+    -> ConstComponentRef_t<ReqCmp_t>
     {
-        const auto cmp_tp_id
-        {
-            mComponents.template GetRequiredComponentTypeID<ReqCmp_t>()
-        };
-
-        const auto cmp_id
-        {
-            ent.GetRequiredComponentID(cmp_tp_id)
-        };
-
-        return mComponents.template
-               GetRequieredComponentByID<ReqCmp_t>(cmp_id);
+        return GetComponentFromStorage<ReqCmp_t>(ent);
     }
 
     template<typename ReqCmp_t,
@@ -318,18 +756,31 @@ public:
                                         Components_t...>::value, bool> = true>
     constexpr auto
     GetRequieredComponent(const OwnEntity_t& ent)
-    -> ReqCmp_t&
+    -> ComponentRef_t<ReqCmp_t>
     {
-        return SameAsConstMemFunc(this,
-                                  &Self_t::template
-                                  GetRequieredComponent<ReqCmp_t>,
-                                  ent);
+        return GetComponentFromStorage<ReqCmp_t>(ent);
+    }
+
+    // Replaces the whole component, the fields of a SoA component are
+    // written one by one. The entity is woken first
+    template<typename ReqCmp_t>
+    constexpr auto
+    SetRequieredComponent(const OwnEntity_t& ent, RemovePCR<ReqCmp_t>&& cmp)
+    -> void
+    {
+        Wake(ent);
+        if constexpr (IsEntityMap) {
+            GetRequieredComponent<RemovePCR<ReqCmp_t>>(ent) = std::move(cmp);
+        } else {
+            mComponents.template SetRequieredComponentByEntity<ReqCmp_t>
+            (ent.GetEntityID(), std::move(cmp));
+        }
     }
     //TODO: add support for Nullable_t
     template<typename ...ReqCmp_t>
     constexpr auto
     GetRequieredComponents([[maybe_unused]]const OwnEntity_t& ent) const
-    -> const Elements_t<const ReqCmp_t&...>
+    -> const Elements_t<ConstComponentRef_t<ReqCmp_t>...>
     {
         return { GetRequieredComponent<ReqCmp_t>(ent)... };
     }
@@ -337,7 +788,7 @@ public:
     template<typename ...ReqCmp_t>
     constexpr auto
     GetRequieredComponents([[maybe_unused]]const OwnEntity_t& ent)
-    -> Elements_t<ReqCmp_t&...>
+    -> Elements_t<ComponentRef_t<ReqCmp_t>...>
     {
         return { GetRequieredComponent<ReqCmp_t>(ent)... };
     }
@@ -350,13 +801,32 @@ public:
     DoForEachComponentTypeIMPL(This_t&& self, Callable_t&& callable)
     -> void
     {
-        for (auto& [eid, cmp] :
-             self.template GetRequieredComponentStorage<MainCmp_t>()) {
-            auto& ent { self.GetEntityByID(eid) };
-            std::invoke(std::forward<Callable_t>(callable),
-                        cmp,
-                        self.template GetRequieredComponent<ExtraCmp_t>(ent)...,
-                        ent);
+        ECS_PROFILE_SCOPE_COUNT("DoForEachComponentType",
+                                (self.template
+                                 CountRows<MainCmp_t, ExtraCmp_t...>()));
+        if constexpr (IsArchetype) {
+            mComponents.template ForEachRow<MainCmp_t, ExtraCmp_t...>(
+                [&self, &callable](EntityID_t eid, auto&... cmps) {
+                    std::invoke(std::forward<Callable_t>(callable),
+                                cmps...,
+                                self.GetEntityByID(eid));
+                });
+        } else {
+            constexpr Signature_t sig { GetSignature<ExtraCmp_t...>() };
+            for (auto&& [eid, cmp] :
+                 self.template GetRequieredComponentStorage<MainCmp_t>()) {
+                auto& ent { self.GetEntityByID(eid) };
+                if constexpr (sizeof...(ExtraCmp_t) > 0) {
+                    if (!ent.HasSignature(sig)) {
+                        continue;
+                    }
+                }
+                std::invoke(std::forward<Callable_t>(callable),
+                            cmp,
+                            self.template
+                            GetRequieredComponent<ExtraCmp_t>(ent)...,
+                            ent);
+            }
         }
     }
 
@@ -431,11 +901,252 @@ public:
             );
     }
 
+    // Rows a loop over the signature walks: the pool of MainCmp_t or the
+    // tables that match. For the profiler and the perf counters
+    template<class MainCmp_t, class... ExtraCmp_t>
+    auto CountRows() const -> std::size_t
+    {
+        if constexpr (IsArchetype) {
+            constexpr Signature_t sig { GetSignature<MainCmp_t,
+                                                     ExtraCmp_t...>() };
+            std::size_t rows { 0 };
+            for (const auto& table : mComponents.GetTables()) {
+                if ((table.mSignature & sig) == sig) {
+                    rows += table.size();
+                }
+            }
+            return rows;
+        } else {
+            return GetRequieredComponentStorage<MainCmp_t>().size();
+        }
+    }
+
+    // Same as DoForEachComponentType but the rows of the main component are
+    // split in cache aligned chunks of about grain rows that run on the
+    // pool, the callable must only touch the components it is given
+    template<class SysSignature_t,
+             class Callable_t,
+             std::enable_if_t<IsVariadicTemplated<SysSignature_t>::value,
+                              bool> = true>
+    auto ParallelForEach(Callable_t&& callable,
+                         std::size_t grain = DefaultGrain,
+                         ThreadPool_t& pool = ThreadPool_t::GetDefault())
+    -> void
+    {
+        ParallelForEachIMPL(DecaySignature(SysSignature_t{  }),
+                            callable, grain, pool);
+    }
+
+    // Hands out whole ranges of rows of the pool of ReqCmp_t instead of one
+    // component at a time, callable(pool, begin, end) runs on the pool for
+    // every cache aligned chunk. It's meant for batch kernels over the rows
+    // of a single component, so it isn't available for the archetype tables
+    template<class ReqCmp_t, class Callable_t>
+    auto ParallelForEachBatch(Callable_t&& callable,
+                              std::size_t grain = DefaultGrain,
+                              ThreadPool_t& pool = ThreadPool_t::GetDefault())
+    -> void
+    {
+        static_assert(!IsArchetype,
+                      "The archetype tables don't have a pool for each"
+                      " component");
+
+        auto& cmps { GetRequieredComponentStorage<ReqCmp_t>() };
+        const auto chunks { SplitInCacheAlignedChunks(cmps.data(),
+                                                      cmps.size(),
+                                                      grain) };
+        pool.ParallelFor(chunks.GetCount(),
+            [&cmps, &chunks, &callable](std::size_t c) {
+                ECS_PROFILE_SCOPE_COUNT("ParallelForEachBatch",
+                                        chunks.GetEnd(c) - chunks.GetBegin(c));
+                std::invoke(callable, cmps, chunks.GetBegin(c),
+                            chunks.GetEnd(c));
+            });
+    }
+
+    // Same as ParallelForEachBatch over the awake rows of the pool only
+    template<class ReqCmp_t, class Callable_t>
+    auto ParallelForEachAwakeBatch(Callable_t&& callable,
+                                   std::size_t grain = DefaultGrain,
+                                   ThreadPool_t& pool =
+                                   ThreadPool_t::GetDefault())
+    -> void
+    {
+        static_assert(!IsArchetype,
+                      "The archetype tables don't have a pool for each"
+                      " component");
+
+        auto& cmps { GetRequieredComponentStorage<ReqCmp_t>() };
+        const auto first { GetAsleepCount<ReqCmp_t>() };
+        const auto chunks { SplitInCacheAlignedChunks(cmps.data() + first,
+                                                      cmps.size() - first,
+                                                      grain) };
+        pool.ParallelFor(chunks.GetCount(),
+            [&cmps, &chunks, &callable, first](std::size_t c) {
+                ECS_PROFILE_SCOPE_COUNT("ParallelForEachAwakeBatch",
+                                        chunks.GetEnd(c) - chunks.GetBegin(c));
+                std::invoke(callable, cmps, first + chunks.GetBegin(c),
+                            first + chunks.GetEnd(c));
+            });
+    }
+
+    // Same as DoForEachComponentType over the awake or the asleep rows of
+    // the pool of the main component, each one a contiguous range
+    template<class SysSignature_t,
+             class Callable_t,
+             std::enable_if_t<IsVariadicTemplated<SysSignature_t>::value,
+                              bool> = true>
+    auto DoForEachAwake(Callable_t&& callable) -> void
+    {
+        if constexpr (IsSparseSet) {
+            ForEachRowIMPL(DecaySignature(SysSignature_t{  }), callable,
+                           true);
+        } else {
+            DoForEachComponentType<SysSignature_t>(callable);
+        }
+    }
+
+    template<class SysSignature_t,
+             class Callable_t,
+             std::enable_if_t<IsVariadicTemplated<SysSignature_t>::value,
+                              bool> = true>
+    auto DoForEachAsleep(Callable_t&& callable) -> void
+    {
+        if constexpr (IsSparseSet) {
+            ForEachRowIMPL(DecaySignature(SysSignature_t{  }), callable,
+                           false);
+        }
+    }
+
 private:
 
-    Storage_t<OwnEntity_t> mEntities {  };
-    ComponentStorage_t<Self_t> mComponents {  };
-    //std::queue<EntityID> mDeadEntities {  };
+    // The components are already gone
+    auto FreeEntitySlot(OwnEntity_t& ent) -> void
+    {
+        if constexpr (IsEntityMap) {
+            ent.DetachAllComponentIDs();
+        }
+        ++ent.m_Generation;
+        mDeadEntities.push_back(ent.GetEntityID());
+        ent.m_ID = InvalidEntityID;
+        ent.m_Awake = true;
+    }
+
+    template<template<class...> class TList_t,
+             class MainCmp_t,
+             class... ExtraCmp_t,
+             class Callable_t>
+    auto ForEachRowIMPL(TList_t<MainCmp_t, ExtraCmp_t...>,
+                        Callable_t& callable,
+                        bool awake)
+    -> void
+    {
+        constexpr Signature_t sig { GetSignature<ExtraCmp_t...>() };
+        auto& main_cmps { GetRequieredComponentStorage<MainCmp_t>() };
+        const auto asleep { GetAsleepCount<MainCmp_t>() };
+        const auto first  { awake ? asleep : 0 };
+        const auto last   { awake ? main_cmps.size() : asleep };
+        ECS_PROFILE_SCOPE_COUNT(awake ? "DoForEachAwake" : "DoForEachAsleep",
+                                last - first);
+        for (auto row { first }; row < last; ++row) {
+            auto&& [eid, cmp] { main_cmps[row] };
+            auto& ent { GetEntityByID(eid) };
+            if constexpr (sizeof...(ExtraCmp_t) > 0) {
+                if (!ent.HasSignature(sig)) {
+                    continue;
+                }
+            }
+            std::invoke(callable,
+                        cmp,
+                        GetRequieredComponent<ExtraCmp_t>(ent)...,
+                        ent);
+        }
+    }
+
+    // A const component in a signature is only read, the storage doesn't
+    // care about it
+    template<template<class...> class TList_t, class... ReqCmps_t>
+    static constexpr auto
+    DecaySignature(TList_t<ReqCmps_t...>) -> TList_t<RemovePCR<ReqCmps_t>...>
+    {
+        return {  };
+    }
+
+    template<template<class...> class TList_t,
+             class MainCmp_t,
+             class... ExtraCmp_t,
+             class Callable_t>
+    auto ParallelForEachIMPL(TList_t<MainCmp_t, ExtraCmp_t...>,
+                             Callable_t& callable,
+                             std::size_t grain,
+                             ThreadPool_t& pool)
+    -> void
+    {
+        if constexpr (IsArchetype) {
+            constexpr Signature_t sig { GetSignature<MainCmp_t,
+                                                     ExtraCmp_t...>() };
+            for (auto& table : mComponents.GetTables()) {
+                if ((table.mSignature & sig) != sig || table.size() == 0) {
+                    continue;
+                }
+                auto& main_col { std::get<Storage_t<MainCmp_t>>
+                                 (table.mColumns) };
+                const auto chunks { SplitInCacheAlignedChunks(main_col.data(),
+                                                              table.size(),
+                                                              grain) };
+                pool.ParallelFor(chunks.GetCount(),
+                    [this, &table, &main_col, &chunks, &callable]
+                    (std::size_t c) {
+                        ECS_PROFILE_SCOPE_COUNT("ParallelForEach",
+                                                chunks.GetEnd(c)
+                                                - chunks.GetBegin(c));
+                        for (auto row { chunks.GetBegin(c) };
+                             row < chunks.GetEnd(c); ++row) {
+                            std::invoke(callable,
+                                        main_col[row],
+                                        std::get<Storage_t<ExtraCmp_t>>
+                                        (table.mColumns)[row]...,
+                                        GetEntityByID(table.mEntities[row]));
+                        }
+                    });
+            }
+        } else {
+            constexpr Signature_t sig { GetSignature<ExtraCmp_t...>() };
+            auto& main_cmps { GetRequieredComponentStorage<MainCmp_t>() };
+            const auto chunks { SplitInCacheAlignedChunks(main_cmps.data(),
+                                                          main_cmps.size(),
+                                                          grain) };
+            pool.ParallelFor(chunks.GetCount(),
+                [this, &main_cmps, &chunks, &callable, sig](std::size_t c) {
+                    ECS_PROFILE_SCOPE_COUNT("ParallelForEach",
+                                            chunks.GetEnd(c)
+                                            - chunks.GetBegin(c));
+                    for (auto row { chunks.GetBegin(c) };
+                         row < chunks.GetEnd(c); ++row) {
+                        auto&& [eid, cmp] { main_cmps[row] };
+                        auto& ent { GetEntityByID(eid) };
+                        if (!ent.HasSignature(sig)) {
+                            continue;
+                        }
+                        std::invoke(callable,
+                                    cmp,
+                                    GetRequieredComponent<ExtraCmp_t>(ent)...,
+                                    ent);
+                    }
+                });
+        }
+    }
+
+    Storage_t<OwnEntity_t>          mEntities     {  };
+    SelfComponentStorage_t          mComponents   {  };
+    Storage_t<EntityID_t>           mDeadEntities {  };
+    Storage_t<EntityID_t>           mRemovedIDs   {  };
+    SelfCommandBuffer_t             mCommands     {  };
+    std::deque<SelfCommandBuffer_t> mRecorders    {  };
 };
 
+template<class... Components_t>
+using EntityManager_t = BasicEntityManager_t<DefaultStoragePolicy_t,
+                                             Components_t...>;
+
 } // namespace ECS
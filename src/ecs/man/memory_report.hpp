@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ECS
+{
+
+// A component that owns memory outside its row, a std::vector or a
+// std::function, says how much with GetHeapBytes() const
+template<class T, class = void>
+struct HasHeapBytes_t : std::false_type {  };
+
+template<class T>
+struct HasHeapBytes_t<T, std::void_t<decltype(std::declval<const T&>()
+                                              .GetHeapBytes())>>
+: std::true_type {  };
+
+template<class T>
+constexpr auto ComponentHeapBytes(const T& cmp) -> std::size_t
+{
+    if constexpr (HasHeapBytes_t<T>::value) {
+        return cmp.GetHeapBytes();
+    } else {
+        return 0;
+    }
+}
+
+// The memory of the pool of one component type. A row is the component plus
+// what the pool keeps with it, the entity ID and the padding between them.
+// The index is the sparse array from entities to rows
+struct PoolMemory_t
+{
+    std::string_view name        {  };
+    std::size_t      count       {  };
+    std::size_t      capacity    {  };
+    std::size_t      row_bytes   {  };
+    std::size_t      padding     {  };
+    std::size_t      index_slots {  };
+    std::size_t      index_bytes {  };
+    std::size_t      heap_bytes  {  };
+
+    constexpr auto GetUsedBytes() const -> std::size_t
+    {
+        return count * row_bytes;
+    }
+
+    constexpr auto GetReservedBytes() const -> std::size_t
+    {
+        return capacity * row_bytes;
+    }
+
+    constexpr auto GetTotalBytes() const -> std::size_t
+    {
+        return GetReservedBytes() + index_bytes + heap_bytes;
+    }
+};
+
+// What a manager holds, a row for each pool plus the entities. A slot of a
+// removed entity stays, and with the entity map storage so do the buckets of
+// its map, so a world that lost most of its entities shows it as dead slots
+// and as reserved bytes far over the used ones
+template<std::size_t N>
+struct MemoryReport_t
+{
+    std::array<PoolMemory_t, N> pools            {  };
+    std::size_t                 entities         {  };
+    std::size_t                 entity_slots     {  };
+    std::size_t                 entity_capacity  {  };
+    std::size_t                 entity_bytes     {  };
+    std::size_t                 entity_map_bytes {  };
+    std::size_t                 storage_bytes    {  };
+    std::size_t                 command_bytes    {  };
+
+    constexpr auto GetTotalBytes() const -> std::size_t
+    {
+        auto total { entity_capacity * entity_bytes + entity_map_bytes
+                     + storage_bytes + command_bytes };
+        for (const auto& pool : pools) {
+            total += pool.GetTotalBytes();
+        }
+        return total;
+    }
+
+    // Slack is the part of the reserved rows that is not used
+    auto Print(std::FILE* out = stdout) const -> void
+    {
+        constexpr double KiB { 1024.0 };
+        auto slack {
+            [](std::size_t used, std::size_t reserved) {
+                return reserved ? 100.0 * double(reserved - used)
+                                        / double(reserved)
+                                : 0.0;
+            }
+        };
+
+        std::fprintf(out, "memory: %.1f KiB, %zu entities in %zu slots"
+                          " (%zu reserved, %.1f%% dead)\n",
+                     double(GetTotalBytes()) / KiB, entities, entity_slots,
+                     entity_capacity,
+                     slack(entities, entity_slots));
+        std::fprintf(out, "  %-24s %10s %10s %5s %5s %10s %10s %7s %10s"
+                          " %10s\n",
+                     "pool", "count", "capacity", "row B", "pad B",
+                     "used KiB", "rsrv KiB", "slack%", "index KiB",
+                     "heap KiB");
+        for (const auto& pool : pools) {
+            std::fprintf(out, "  %-24.*s %10zu %10zu %5zu %5zu %10.1f %10.1f"
+                              " %7.1f %10.1f %10.1f\n",
+                         static_cast<int>(pool.name.size()), pool.name.data(),
+                         pool.count, pool.capacity, pool.row_bytes,
+                         pool.padding,
+                         double(pool.GetUsedBytes()) / KiB,
+                         double(pool.GetReservedBytes()) / KiB,
+                         slack(pool.count, pool.capacity),
+                         double(pool.index_bytes) / KiB,
+                         double(pool.heap_bytes) / KiB);
+        }
+        std::fprintf(out, "  entities %.1f KiB (%zu B each), entity maps"
+                          " %.1f KiB, storage %.1f KiB, commands %.1f KiB\n",
+                     double(entity_capacity * entity_bytes) / KiB,
+                     entity_bytes, double(entity_map_bytes) / KiB,
+                     double(storage_bytes) / KiB,
+                     double(command_bytes) / KiB);
+    }
+};
+
+// Prints the report of the manager every `every` calls to Update, after the
+// flush of the frame. 0 never prints
+class MemorySummary_t final
+{
+
+public:
+
+    explicit MemorySummary_t(std::uint64_t every, std::FILE* out = stdout)
+    : mEvery { every },
+      mOut   { out } {  }
+
+    template<class EntMan_t>
+    auto Update(const EntMan_t& ent_man) -> void
+    {
+        if (mEvery == 0 || ++mFrame % mEvery != 0) {
+            return;
+        }
+        std::fprintf(mOut, "frame %llu ",
+                     static_cast<unsigned long long>(mFrame));
+        ent_man.GetMemoryReport().Print(mOut);
+    }
+
+private:
+
+    std::uint64_t mEvery {  };
+    std::uint64_t mFrame {  };
+    std::FILE*    mOut   {  };
+};
+
+} // namespace ECS
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <type_traits>
+
+#include <ecs/cmp/entity.hpp>
+
+namespace ECS
+{
+
+///////////////////////////////////////////////////////////////////////////////
+// Storage policies for BasicEntityManager_t
+///////////////////////////////////////////////////////////////////////////////
+
+// Every entity owns an unordered_map from component type to the index of its
+// component inside the pool of that type
+struct EntityMapStorage_t {  };
+
+// Every pool owns a sparse array indexed by entity that points into its dense
+// array of components, the entity is only an ID
+struct SparseSetStorage_t {  };
+
+// Entities with the same set of components share a table with one column
+// for each component type, adding or removing a component moves the entity
+// to the table of its new set
+struct ArchetypeStorage_t {  };
+
+using DefaultStoragePolicy_t = SparseSetStorage_t;
+
+template<class StoragePolicy_t>
+struct StoragePolicyTraits_t;
+
+template<>
+struct StoragePolicyTraits_t<EntityMapStorage_t>
+{
+    using EntityBase_type = EntityBase_t;
+    constexpr static inline bool IsSparseSet { false };
+    constexpr static inline bool IsArchetype { false };
+};
+
+template<>
+struct StoragePolicyTraits_t<SparseSetStorage_t>
+{
+    using EntityBase_type = EmptyEntityBase_t;
+    constexpr static inline bool IsSparseSet { true };
+    constexpr static inline bool IsArchetype { false };
+};
+
+template<>
+struct StoragePolicyTraits_t<ArchetypeStorage_t>
+{
+    using EntityBase_type = EmptyEntityBase_t;
+    constexpr static inline bool IsSparseSet { false };
+    constexpr static inline bool IsArchetype { true };
+};
+
+} // namespace ECS
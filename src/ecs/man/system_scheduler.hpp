@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "command_buffer.hpp"
+
+#include <ecs/util/helpers.hpp>
+#include <ecs/util/thread_pool.hpp>
+#include <tmp/type_list.hpp>
+
+namespace ECS
+{
+
+// The access list of a system has the components of its signature plus the
+// resources it touches outside of the manager, a const type is only read and
+// any other type is written. Two lists conflict when one of them writes a
+// type that the other one reads or writes
+template<class FirstAccess_t, class SecondAccess_t>
+struct AccessConflict_t;
+
+template<template<class...> class FirstList_t,  class... First_t,
+         template<class...> class SecondList_t, class... Second_t>
+struct AccessConflict_t<FirstList_t<First_t...>, SecondList_t<Second_t...>>
+{
+    template<class A, class B>
+    constexpr static inline bool Conflict
+    {
+        std::is_same_v<std::remove_const_t<A>, std::remove_const_t<B>>
+        && !(std::is_const_v<A> && std::is_const_v<B>)
+    };
+
+    template<class A>
+    constexpr static inline bool ConflictsWithSecond
+    {
+        (Conflict<A, Second_t> || ...)
+    };
+
+    constexpr static inline bool value { (ConflictsWithSecond<First_t> || ...) };
+};
+
+// Dependency graph of the systems, a system depends on every system listed
+// before it whose accesses conflict with its own. The systems are grouped in
+// levels, the systems of a level only depend on systems of previous levels
+template<class... Systems_t>
+struct SystemGraph_t
+{
+    constexpr static inline std::size_t SystemCount { sizeof...(Systems_t) };
+
+    template<class System_t>
+    using Access_t = typename TMP::TypeListCat_t<
+                                typename System_t::SystemSignature_t,
+                                typename System_t::SystemResources_t>::type;
+
+    template<std::size_t I>
+    using SystemAt_t = std::tuple_element_t<I, std::tuple<Systems_t...>>;
+
+    struct Plan_t
+    {
+        std::array<std::uint64_t, SystemCount>    dependencies {  };
+        std::array<std::size_t,   SystemCount>    order        {  };
+        std::array<std::size_t,   SystemCount + 1> level_begin {  };
+        std::size_t                               level_count  {  };
+    };
+
+    template<std::size_t I, std::size_t... J>
+    constexpr static auto
+    DependenciesOf(std::index_sequence<J...>) -> std::uint64_t
+    {
+        return (0ULL | ... | ((J < I && AccessConflict_t<
+                                          Access_t<SystemAt_t<I>>,
+                                          Access_t<SystemAt_t<J>>>::value)
+                              ? (1ULL << J) : 0ULL));
+    }
+
+    template<std::size_t... I>
+    constexpr static auto
+    GetDependencies(std::index_sequence<I...> seq)
+    -> std::array<std::uint64_t, SystemCount>
+    {
+        return { DependenciesOf<I>(seq)... };
+    }
+
+    constexpr static auto MakePlan() -> Plan_t
+    {
+        Plan_t plan {  };
+        plan.dependencies = GetDependencies(
+                                std::index_sequence_for<Systems_t...>{});
+
+        std::array<std::size_t, SystemCount> levels {  };
+        for (std::size_t i { 0 }; i < SystemCount; ++i) {
+            for (std::size_t j { 0 }; j < i; ++j) {
+                if (plan.dependencies[i] & (1ULL << j)) {
+                    levels[i] = std::max(levels[i], levels[j] + 1);
+                }
+            }
+            plan.level_count = std::max(plan.level_count, levels[i] + 1);
+        }
+
+        std::size_t pos { 0 };
+        for (std::size_t level { 0 }; level < plan.level_count; ++level) {
+            plan.level_begin[level] = pos;
+            for (std::size_t i { 0 }; i < SystemCount; ++i) {
+                if (levels[i] == level) {
+                    plan.order[pos++] = i;
+                }
+            }
+        }
+        plan.level_begin[plan.level_count] = pos;
+        return plan;
+    }
+};
+
+// Runs the systems level by level, the systems of the same level run at the
+// same time on the pool. Every system records into a command buffer of its
+// own, see RecorderScope_t, so recording is not in the access lists. The
+// result is the same as calling their Update one after another in the order
+// they were given
+template<class... Systems_t>
+class SystemScheduler_t final
+{
+
+public:
+
+    using Graph_t = SystemGraph_t<Systems_t...>;
+
+    constexpr static inline auto Plan { Graph_t::MakePlan() };
+
+    explicit SystemScheduler_t(Systems_t&... systems)
+    : mSystems { systems... }
+    {
+        static_assert(sizeof...(Systems_t) > 0
+                      && sizeof...(Systems_t) <= 64,
+                      "The dependencies of a system are a 64 bits mask");
+    }
+
+    template<class EntMan_t>
+    auto Update(EntMan_t& ent_man,
+                ThreadPool_t& pool = ThreadPool_t::GetDefault())
+    -> void
+    {
+        ent_man.ReserveRecorders(sizeof...(Systems_t));
+        for (std::size_t level { 0 }; level < Plan.level_count; ++level) {
+            const auto begin { Plan.level_begin[level] };
+            const auto end   { Plan.level_begin[level + 1] };
+            pool.ParallelFor(end - begin,
+                [this, &ent_man, begin](std::size_t task) {
+                    UpdateSystem(ent_man,
+                                 Plan.order[begin + task],
+                                 std::index_sequence_for<Systems_t...>{});
+                });
+        }
+    }
+
+private:
+
+    template<class EntMan_t, std::size_t... I>
+    auto UpdateSystem(EntMan_t& ent_man,
+                      std::size_t index,
+                      std::index_sequence<I...>)
+    -> void
+    {
+        const RecorderScope_t recorder { index + 1 };
+        ((I == index ? (void)std::get<I>(mSystems).Update(ent_man)
+                     : (void)0), ...);
+    }
+
+    Elements_t<Systems_t&...> mSystems;
+};
+
+} // namespace ECS
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+#include <ecs/util/type_aliases.hpp>
+#include <ecs/util/helpers.hpp>
+
+namespace ECS
+{
+
+///////////////////////////////////////////////////////////////////////////////
+// Views over the entities that have all the Cs components, dereferencing an
+// iterator gives a tuple with the components followed by the entity:
+//
+//     for (auto [phy, col, ent] : ent_man.template View<Phy_t, Col_t>())
+///////////////////////////////////////////////////////////////////////////////
+
+// The smallest pool is picked when the view is made and drives the walk, the
+// entities of that pool without the rest of the components are skipped
+template<class EntMan_t, class... Cs>
+class PoolView_t final
+{
+
+public:
+
+    using Entity_type = typename EntMan_t::OwnEntity_t;
+    using value_type  = Elements_t<typename EntMan_t::
+                                   template ComponentRef_t<Cs>...,
+                                   Entity_type&>;
+
+    class Iterator_t final
+    {
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename PoolView_t::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = value_type;
+
+        constexpr Iterator_t(const PoolView_t& view, std::size_t row)
+        : mView { &view }, mRow { row }
+        {
+            SkipNonMatching();
+        }
+
+        auto operator*() const -> reference
+        {
+            return mView->GetRow(mRow, mEid, std::index_sequence_for<Cs...>{});
+        }
+
+        auto operator++() -> Iterator_t&
+        {
+            ++mRow;
+            SkipNonMatching();
+            return *this;
+        }
+
+        constexpr auto operator==(const Iterator_t& other) const -> bool
+        {
+            return mRow == other.mRow;
+        }
+
+        constexpr auto operator!=(const Iterator_t& other) const -> bool
+        {
+            return !(*this == other);
+        }
+
+    private:
+
+        auto SkipNonMatching() -> void
+        {
+            for (; mRow < mView->mDriverSize; ++mRow) {
+                mEid = mView->EntityIDAt(mRow);
+                if (mView->Matches(mEid)) {
+                    return;
+                }
+            }
+        }
+
+        const PoolView_t* mView {  };
+        std::size_t       mRow  {  };
+        EntityID_t        mEid  { InvalidEntityID };
+    };
+
+    explicit PoolView_t(EntMan_t& ent_man)
+    : mEntMan { ent_man },
+      mPools  { &ent_man.template GetRequieredComponentStorage<Cs>()... }
+    {
+        const std::array<std::size_t, sizeof...(Cs)> sizes
+        {
+            std::get<typename EntMan_t::template VecComponent_t<Cs>*>
+            (mPools)->size()...
+        };
+        const auto smallest { std::min_element(sizes.begin(), sizes.end()) };
+        mDriver     = static_cast<std::size_t>(smallest - sizes.begin());
+        mDriverSize = *smallest;
+    }
+
+    auto begin() const -> Iterator_t { return { *this, 0 }; }
+    auto end()   const -> Iterator_t { return { *this, mDriverSize }; }
+
+    // Upper bound of the entities in the view
+    constexpr auto GetDriverSize() const -> std::size_t
+    {
+        return mDriverSize;
+    }
+
+private:
+
+    auto EntityIDAt(std::size_t row) const -> EntityID_t
+    {
+        return EntityIDAt(row, std::index_sequence_for<Cs...>{});
+    }
+
+    template<std::size_t... I>
+    auto EntityIDAt(std::size_t row, std::index_sequence<I...>) const
+    -> EntityID_t
+    {
+        EntityID_t eid { InvalidEntityID };
+        ((I == mDriver
+          ? (void)(eid = (*std::get<I>(mPools))[row].GetEntityID())
+          : (void)0), ...);
+        return eid;
+    }
+
+    auto Matches(EntityID_t eid) const -> bool
+    {
+        constexpr auto sig { EntMan_t::template GetSignature<Cs...>() };
+        return mEntMan.GetEntityByID(eid).HasSignature(sig);
+    }
+
+    // The component of the driver pool is already at hand, the others are
+    // looked up through the entity
+    template<std::size_t... I>
+    auto GetRow(std::size_t row, EntityID_t eid, std::index_sequence<I...>)
+    const -> value_type
+    {
+        auto& ent { mEntMan.GetEntityByID(eid) };
+        return
+        {
+            (I == mDriver ? (*std::get<I>(mPools))[row].Self
+                          : mEntMan.template GetRequieredComponent<Cs>(ent))...,
+            ent
+        };
+    }
+
+    EntMan_t&                                                   mEntMan;
+    Elements_t<typename EntMan_t::template VecComponent_t<Cs>*...> mPools;
+    std::size_t mDriver     {  };
+    std::size_t mDriverSize {  };
+};
+
+// Only the tables whose signature has all the components are walked, so
+// there is nothing to skip inside a table
+template<class EntMan_t, class... Cs>
+class ArchetypeView_t final
+{
+
+public:
+
+    using Entity_type = typename EntMan_t::OwnEntity_t;
+    using Table_type  = typename EntMan_t::SelfComponentStorage_t::Table_t;
+    using value_type  = Elements_t<Cs&..., Entity_type&>;
+
+    class Iterator_t final
+    {
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = typename ArchetypeView_t::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = value_type;
+
+        constexpr Iterator_t(const ArchetypeView_t& view, std::size_t table)
+        : mView { &view }, mTable { table }
+        {
+            SkipNonMatching();
+        }
+
+        auto operator*() const -> reference
+        {
+            auto& table { (*mView->mTables)[mTable] };
+            return
+            {
+                std::get<Storage_t<Cs>>(table.mColumns)[mRow]...,
+                mView->mEntMan.GetEntityByID(table.mEntities[mRow])
+            };
+        }
+
+        auto operator++() -> Iterator_t&
+        {
+            if (++mRow == (*mView->mTables)[mTable].size()) {
+                ++mTable;
+                mRow = 0;
+                SkipNonMatching();
+            }
+            return *this;
+        }
+
+        constexpr auto operator==(const Iterator_t& other) const -> bool
+        {
+            return mTable == other.mTable && mRow == other.mRow;
+        }
+
+        constexpr auto operator!=(const Iterator_t& other) const -> bool
+        {
+            return !(*this == other);
+        }
+
+    private:
+
+        auto SkipNonMatching() -> void
+        {
+            constexpr auto sig { EntMan_t::template GetSignature<Cs...>() };
+            const auto& tables { *mView->mTables };
+            while (mTable < tables.size()
+                   && (tables[mTable].size() == 0
+                       || (tables[mTable].mSignature & sig) != sig)) {
+                ++mTable;
+            }
+        }
+
+        const ArchetypeView_t* mView  {  };
+        std::size_t            mTable {  };
+        std::size_t            mRow   {  };
+    };
+
+    ArchetypeView_t(EntMan_t& ent_man, Storage_t<Table_type>& tables)
+    : mEntMan { ent_man }, mTables { &tables } {  }
+
+    auto begin() const -> Iterator_t { return { *this, 0 }; }
+    auto end()   const -> Iterator_t { return { *this, mTables->size() }; }
+
+private:
+
+    EntMan_t&              mEntMan;
+    Storage_t<Table_type>* mTables {  };
+};
+
+} // namespace ECS
@@ -0,0 +1,305 @@
+#pragma once
+
+// Counts the allocations of the frames and of the systems, built with
+// ECS_ALLOC_TRACKING defined (make ALLOCS=1). Without it the macros are empty
+//
+// ECS_ALLOC_SCOPE(name)         the allocations of this thread in the rest of
+//                               the block go to name
+// ECS_ALLOC_STEADY_SCOPE(name, steady)
+//                               while steady is true any allocation of any
+//                               thread in the rest of the block is an error,
+//                               it's logged with a stack trace or, with
+//                               ECS_ALLOC_STEADY_ABORT defined (make
+//                               ALLOCS=abort), it aborts
+// ECS_ALLOC_TRACK(bytes)        what the replaced operator new calls
+//
+// The global operator new is replaced by ecs/util/alloc_tracker_new.hpp,
+// include it in one source of the program. Link with -rdynamic for the names
+// of the functions in the stack traces. The name must be a string literal
+
+#ifdef ECS_ALLOC_TRACKING
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define ECS_ALLOC_BACKTRACE 1
+#endif
+
+#define ECS_ALLOC_CONCAT_IMPL(a, b) a##b
+#define ECS_ALLOC_CONCAT(a, b)      ECS_ALLOC_CONCAT_IMPL(a, b)
+
+#define ECS_ALLOC_SCOPE(name)                                                \
+    const ::ECS::AllocScope_t ECS_ALLOC_CONCAT(ecs_alloc_, __LINE__) { name }
+
+#define ECS_ALLOC_STEADY_SCOPE(name, steady)                                 \
+    const ::ECS::AllocSteadyScope_t ECS_ALLOC_CONCAT(ecs_alloc_steady_,      \
+                                                     __LINE__)               \
+    { name, steady }
+
+#define ECS_ALLOC_TRACK(bytes) ::ECS::AllocTracker_t::Get().Record(bytes)
+
+namespace ECS
+{
+
+struct AllocStat_t
+{
+    const char*                name   {  };
+    std::atomic<std::uint64_t> allocs { 0 };
+    std::atomic<std::uint64_t> bytes  { 0 };
+};
+
+// The scope of the thread, null outside of every ECS_ALLOC_SCOPE
+inline thread_local AllocStat_t* tAllocScope { nullptr };
+
+// Set while a steady allocation is reported, the report may allocate too
+inline thread_local bool tAllocReporting { false };
+
+// Nothing here allocates, it runs inside operator new. The scopes live in a
+// fixed array, the last slot is shared by the ones that don't fit
+class AllocTracker_t final
+{
+
+public:
+
+    constexpr static inline std::size_t MaxScopes { 64 };
+
+    enum class SteadyMode_t
+    {
+        Log,
+        Abort
+    };
+
+    static auto Get() -> AllocTracker_t&
+    {
+        static AllocTracker_t tracker {  };
+        return tracker;
+    }
+
+    auto Record(std::size_t bytes) -> void
+    {
+        mFrameAllocs.fetch_add(1, std::memory_order_relaxed);
+        mFrameBytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (auto* stat { tAllocScope }) {
+            stat->allocs.fetch_add(1, std::memory_order_relaxed);
+            stat->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        if (mSteady.load(std::memory_order_relaxed) > 0) {
+            OnSteadyAllocation(bytes);
+        }
+    }
+
+    // A scope is found by the pointer to its name without the lock, the
+    // first time it's added under the lock
+    auto GetStat(const char* name) -> AllocStat_t&
+    {
+        const auto count { mScopeCount.load(std::memory_order_acquire) };
+        for (std::size_t s { 0 }; s < count; ++s) {
+            if (mScopes[s].name == name) {
+                return mScopes[s];
+            }
+        }
+        return Register(name);
+    }
+
+    // The allocations since the last call are one frame, of every thread
+    auto EndFrame() -> void
+    {
+        const auto allocs { mFrameAllocs.exchange(0) };
+        const auto bytes  { mFrameBytes.exchange(0) };
+        if (allocs > mMaxFrameAllocs) {
+            mMaxFrameAllocs = allocs;
+            mMaxFrame       = mFrames;
+        }
+        mTotalAllocs += allocs;
+        mTotalBytes  += bytes;
+        mSteadyFrames += allocs == 0;
+        ++mFrames;
+    }
+
+    auto EnterSteady(const char* name) -> void
+    {
+        if (mSteady.fetch_add(1) == 0) {
+            mSteadyName.store(name);
+        }
+    }
+
+    auto LeaveSteady() -> void { mSteady.fetch_sub(1); }
+
+    auto SetSteadyMode(SteadyMode_t mode) -> void { mMode.store(mode); }
+
+    auto GetSteadyAllocations() const -> std::uint64_t
+    {
+        return mSteadyAllocs.load();
+    }
+
+    auto Report(std::FILE* out = stdout) const -> void
+    {
+        const auto frames { double(mFrames ? mFrames : 1) };
+        std::fprintf(out, "allocations: %llu frames, %llu without"
+                          " allocations, %.2f allocs and %.1f B a frame,"
+                          " max %llu in frame %llu, %llu in steady"
+                          " sections\n",
+                     static_cast<unsigned long long>(mFrames),
+                     static_cast<unsigned long long>(mSteadyFrames),
+                     double(mTotalAllocs) / frames,
+                     double(mTotalBytes) / frames,
+                     static_cast<unsigned long long>(mMaxFrameAllocs),
+                     static_cast<unsigned long long>(mMaxFrame),
+                     static_cast<unsigned long long>(mSteadyAllocs.load()));
+        std::fprintf(out, "%-32s %10s %12s %12s\n",
+                     "scope", "allocs", "bytes", "allocs/frame");
+        const auto count { mScopeCount.load(std::memory_order_acquire) };
+        for (std::size_t s { 0 }; s < count; ++s) {
+            const auto allocs { mScopes[s].allocs.load() };
+            std::fprintf(out, "%-32s %10llu %12llu %12.2f\n",
+                         mScopes[s].name,
+                         static_cast<unsigned long long>(allocs),
+                         static_cast<unsigned long long>(
+                             mScopes[s].bytes.load()),
+                         double(allocs) / frames);
+        }
+    }
+
+    // The first backtrace loads the unwinder, which allocates
+    auto WarmUp() -> void
+    {
+#ifdef ECS_ALLOC_BACKTRACE
+        std::call_once(mWarmUp, [] {
+            void* frame {  };
+            backtrace(&frame, 1);
+        });
+#endif
+    }
+
+private:
+
+    AllocTracker_t() = default;
+
+    auto Register(const char* name) -> AllocStat_t&
+    {
+        std::lock_guard lock { mMutex };
+        const auto count { mScopeCount.load(std::memory_order_relaxed) };
+        for (std::size_t s { 0 }; s < count; ++s) {
+            if (std::strcmp(mScopes[s].name, name) == 0) {
+                return mScopes[s];
+            }
+        }
+        if (count == MaxScopes) {
+            return mScopes[MaxScopes - 1];
+        }
+        mScopes[count].name = count + 1 == MaxScopes ? "(other scopes)"
+                                                     : name;
+        mScopeCount.store(count + 1, std::memory_order_release);
+        return mScopes[count];
+    }
+
+    auto OnSteadyAllocation(std::size_t bytes) -> void
+    {
+        if (tAllocReporting) {
+            return;
+        }
+        tAllocReporting = true;
+        mSteadyAllocs.fetch_add(1, std::memory_order_relaxed);
+        std::fprintf(stderr, "allocation of %zu B in the steady section %s,"
+                             " scope %s\n",
+                     bytes, mSteadyName.load(),
+                     tAllocScope ? tAllocScope->name : "none");
+#ifdef ECS_ALLOC_BACKTRACE
+        std::array<void*, 32> frames {  };
+        const auto depth { backtrace(frames.data(), int(frames.size())) };
+        backtrace_symbols_fd(frames.data(), depth, 2);
+#endif
+        if (mMode.load() == SteadyMode_t::Abort) {
+            std::abort();
+        }
+        tAllocReporting = false;
+    }
+
+    std::array<AllocStat_t, MaxScopes> mScopes         {  };
+    std::atomic<std::size_t>           mScopeCount     { 0 };
+    std::mutex                         mMutex          {  };
+    std::once_flag                     mWarmUp         {  };
+
+    std::atomic<std::uint64_t>         mFrameAllocs    { 0 };
+    std::atomic<std::uint64_t>         mFrameBytes     { 0 };
+    std::uint64_t                      mFrames         {  };
+    std::uint64_t                      mSteadyFrames   {  };
+    std::uint64_t                      mTotalAllocs    {  };
+    std::uint64_t                      mTotalBytes     {  };
+    std::uint64_t                      mMaxFrameAllocs {  };
+    std::uint64_t                      mMaxFrame       {  };
+
+    std::atomic<int>                   mSteady         { 0 };
+    std::atomic<const char*>           mSteadyName     { "" };
+    std::atomic<std::uint64_t>         mSteadyAllocs   { 0 };
+#ifdef ECS_ALLOC_STEADY_ABORT
+    std::atomic<SteadyMode_t>          mMode           { SteadyMode_t::Abort };
+#else
+    std::atomic<SteadyMode_t>          mMode           { SteadyMode_t::Log };
+#endif
+};
+
+class AllocScope_t final
+{
+
+public:
+
+    explicit AllocScope_t(const char* name) : mPrevious { tAllocScope }
+    {
+        tAllocScope = &AllocTracker_t::Get().GetStat(name);
+    }
+
+    ~AllocScope_t() { tAllocScope = mPrevious; }
+
+    AllocScope_t(const AllocScope_t&) = delete;
+    auto operator=(const AllocScope_t&) -> AllocScope_t& = delete;
+
+private:
+
+    AllocStat_t* mPrevious {  };
+};
+
+class AllocSteadyScope_t final
+{
+
+public:
+
+    AllocSteadyScope_t(const char* name, bool steady) : mSteady { steady }
+    {
+        if (mSteady) {
+            AllocTracker_t::Get().WarmUp();
+            AllocTracker_t::Get().EnterSteady(name);
+        }
+    }
+
+    ~AllocSteadyScope_t()
+    {
+        if (mSteady) {
+            AllocTracker_t::Get().LeaveSteady();
+        }
+    }
+
+    AllocSteadyScope_t(const AllocSteadyScope_t&) = delete;
+    auto operator=(const AllocSteadyScope_t&) -> AllocSteadyScope_t& = delete;
+
+private:
+
+    bool mSteady {  };
+};
+
+} // namespace ECS
+
+#else
+
+#define ECS_ALLOC_SCOPE(name)                static_cast<void>(0)
+#define ECS_ALLOC_STEADY_SCOPE(name, steady) static_cast<void>(0)
+#define ECS_ALLOC_TRACK(bytes)               static_cast<void>(0)
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+// The global allocation functions that feed the tracker of
+// ecs/util/alloc_tracker.hpp. They are definitions, include this in only one
+// source of the program. Without ECS_ALLOC_TRACKING it's empty
+
+#include "alloc_tracker.hpp"
+
+#ifdef ECS_ALLOC_TRACKING
+
+#include <cstdlib>
+#include <new>
+
+// aligned_alloc wants the size rounded up to the alignment
+inline auto TrackedAllocate(std::size_t size, std::size_t align) -> void*
+{
+    ECS_ALLOC_TRACK(size);
+    const auto rounded { (size ? size + align - 1 : align) / align * align };
+    void* ptr
+    {
+        align <= alignof(std::max_align_t) ? std::malloc(size ? size : 1)
+                                           : std::aligned_alloc(align, rounded)
+    };
+    if (!ptr) {
+        std::abort();
+    }
+    return ptr;
+}
+
+auto operator new(std::size_t size) -> void*
+{
+    return TrackedAllocate(size, alignof(std::max_align_t));
+}
+
+auto operator new[](std::size_t size) -> void*
+{
+    return TrackedAllocate(size, alignof(std::max_align_t));
+}
+
+auto operator new(std::size_t size, std::align_val_t align) -> void*
+{
+    return TrackedAllocate(size, static_cast<std::size_t>(align));
+}
+
+auto operator new[](std::size_t size, std::align_val_t align) -> void*
+{
+    return TrackedAllocate(size, static_cast<std::size_t>(align));
+}
+
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void* ptr, std::size_t) noexcept -> void { std::free(ptr); }
+auto operator delete[](void* ptr, std::size_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::align_val_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr, std::align_val_t) noexcept -> void
+{
+    std::free(ptr);
+}
+
+auto operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+-> void
+{
+    std::free(ptr);
+}
+
+auto operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+-> void
+{
+    std::free(ptr);
+}
+
+#endif
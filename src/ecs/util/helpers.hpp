@@ -1,7 +1,9 @@
 #pragma once
 
 #include "ecs/util/type_aliases.hpp"
+#include <algorithm>
 #include <functional>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -152,6 +154,43 @@ public:
 
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// ReserveMore
+///////////////////////////////////////////////////////////////////////////////
+
+// Makes room for n elements in all keeping the geometric growth of the
+// vector, so a buffer cleared every frame stops growing once it's reserved
+// for the largest frame
+template<class Vector_t>
+auto ReserveAtLeast(Vector_t& vec, std::size_t n) -> void
+{
+    if (n > vec.capacity()) {
+        vec.reserve(std::max(n, 2 * vec.capacity()));
+    }
+}
+
+// Makes room for n more elements keeping the geometric growth of the vector
+template<class Vector_t>
+auto ReserveMore(Vector_t& vec, std::size_t n) -> void
+{
+    ReserveAtLeast(vec, vec.size() + n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TypeName
+///////////////////////////////////////////////////////////////////////////////
+
+// The name of T as the compiler spells it, there is no RTTI to ask. GCC
+// writes "[with T = Name; ...]" and Clang "[T = Name]"
+template<class T>
+constexpr auto TypeName() -> std::string_view
+{
+    constexpr std::string_view func { __PRETTY_FUNCTION__ };
+    constexpr auto begin { func.find("T = ") + 4 };
+    constexpr auto end   { func.find_first_of(";]", begin) };
+    return func.substr(begin, end - begin);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Args_t
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,340 @@
+#pragma once
+
+// Hardware counters of the systems, built with ECS_PERF_COUNTERS defined
+// (make PERF=1) and only on Linux, elsewhere the macros are empty
+//
+// ECS_PERF_SCOPE(name, entities)  counts the rest of the block
+//
+// Each thread opens its own group of counters with perf_event_open the first
+// time, so a scope only counts the thread it runs on: the tasks a system
+// hands to the pool need their own scopes. When the kernel doesn't give the
+// counters, see /proc/sys/kernel/perf_event_paranoid, the scopes only count
+// the calls and the report says why. The name must be a string literal
+
+#if defined(ECS_PERF_COUNTERS) && defined(__linux__)
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define ECS_PERF_CONCAT_IMPL(a, b) a##b
+#define ECS_PERF_CONCAT(a, b)      ECS_PERF_CONCAT_IMPL(a, b)
+
+#define ECS_PERF_SCOPE(name, entities)                                       \
+    const ::ECS::PerfScope_t ECS_PERF_CONCAT(ecs_perf_, __LINE__)            \
+    { name, static_cast<std::uint64_t>(entities) }
+
+namespace ECS
+{
+
+enum PerfCounter_t : std::size_t
+{
+    PerfCycles,
+    PerfInstructions,
+    PerfL1DMisses,
+    PerfLLCMisses,
+    PerfBranchMisses,
+    PerfCounterCount
+};
+
+// Counters of one thread. The cycles lead the group, the rest are read with
+// them in one call and left out if the CPU doesn't have them
+class PerfCounterGroup_t final
+{
+
+public:
+
+    struct Sample_t
+    {
+        std::array<std::uint64_t, PerfCounterCount> values  {  };
+        std::uint64_t                               enabled {  };
+        std::uint64_t                               running {  };
+    };
+
+    PerfCounterGroup_t()
+    {
+        constexpr std::uint64_t l1d_read_miss
+        {
+            PERF_COUNT_HW_CACHE_L1D
+            | PERF_COUNT_HW_CACHE_OP_READ << 8
+            | PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+        };
+        const std::array<std::pair<std::uint32_t, std::uint64_t>,
+                         PerfCounterCount> events
+        {{
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES    },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS  },
+            { PERF_TYPE_HW_CACHE, l1d_read_miss               },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES  },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+        }};
+
+        mFds.fill(-1);
+        mSlots.fill(-1);
+        for (std::size_t c { 0 }; c < PerfCounterCount; ++c) {
+            perf_event_attr attr {  };
+            attr.size           = sizeof(attr);
+            attr.type           = events[c].first;
+            attr.config         = events[c].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP
+                                | PERF_FORMAT_TOTAL_TIME_ENABLED
+                                | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const auto fd
+            {
+                static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                         mFds[0], 0))
+            };
+            if (fd < 0) {
+                if (c == PerfCycles) {
+                    mError = errno;
+                    return;
+                }
+                continue;
+            }
+            mFds[c]   = fd;
+            mSlots[c] = static_cast<int>(mMembers++);
+        }
+    }
+
+    ~PerfCounterGroup_t()
+    {
+        for (const auto fd : mFds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    PerfCounterGroup_t(const PerfCounterGroup_t&) = delete;
+    auto operator=(const PerfCounterGroup_t&) -> PerfCounterGroup_t& = delete;
+
+    auto IsOpen() const -> bool { return mFds[0] >= 0; }
+    auto GetError() const -> int { return mError; }
+
+    auto Has(std::size_t counter) const -> bool
+    {
+        return mSlots[counter] >= 0;
+    }
+
+    auto Read(Sample_t& sample) const -> bool
+    {
+        std::array<std::uint64_t, 3 + PerfCounterCount> buf {  };
+        if (!IsOpen() || read(mFds[0], buf.data(), sizeof(buf)) <= 0) {
+            return false;
+        }
+        sample.enabled = buf[1];
+        sample.running = buf[2];
+        for (std::size_t c { 0 }; c < PerfCounterCount; ++c) {
+            sample.values[c] = Has(c) ? buf[3 + mSlots[c]] : 0;
+        }
+        return true;
+    }
+
+private:
+
+    std::array<int, PerfCounterCount> mFds     {  };
+    std::array<int, PerfCounterCount> mSlots   {  };
+    std::size_t                       mMembers {  };
+    int                               mError   {  };
+};
+
+struct PerfStat_t
+{
+    const char*                          name     {  };
+    std::uint64_t                        calls    {  };
+    std::uint64_t                        entities {  };
+    std::array<double, PerfCounterCount> counts   {  };
+};
+
+// The group and the totals of one thread, only that thread writes them
+struct PerfThread_t
+{
+    auto GetStat(const char* name) -> PerfStat_t&
+    {
+        for (auto& stat : stats) {
+            if (stat.name == name) {
+                return stat;
+            }
+        }
+        return stats.emplace_back(PerfStat_t{ name });
+    }
+
+    PerfCounterGroup_t      group {  };
+    std::vector<PerfStat_t> stats {  };
+};
+
+// Owns the counters of every thread that opened a scope, the report adds up
+// the totals of all of them by name
+class PerfCounters_t final
+{
+
+public:
+
+    static auto Get() -> PerfCounters_t&
+    {
+        static PerfCounters_t counters {  };
+        return counters;
+    }
+
+    static auto GetThread() -> PerfThread_t&
+    {
+        thread_local PerfThread_t* thread { Get().Register() };
+        return *thread;
+    }
+
+    // IPC and the misses per entity of every scope. Call it between frames,
+    // the scopes running on other threads write the totals
+    auto Report(std::FILE* out = stdout) const -> void
+    {
+        std::lock_guard lock { mMutex };
+        std::vector<PerfStat_t> totals {  };
+        std::array<bool, PerfCounterCount> has {  };
+        int error {  };
+        for (const auto& thread : mThreads) {
+            for (std::size_t c { 0 }; c < PerfCounterCount; ++c) {
+                has[c] = has[c] || thread->group.Has(c);
+            }
+            error = error ? error : thread->group.GetError();
+            for (const auto& stat : thread->stats) {
+                auto it { std::find_if(totals.begin(), totals.end(),
+                    [&stat](const PerfStat_t& total) {
+                        return std::strcmp(total.name, stat.name) == 0;
+                    }) };
+                if (it == totals.end()) {
+                    it = totals.insert(totals.end(), PerfStat_t{ stat.name });
+                }
+                it->calls    += stat.calls;
+                it->entities += stat.entities;
+                for (std::size_t c { 0 }; c < PerfCounterCount; ++c) {
+                    it->counts[c] += stat.counts[c];
+                }
+            }
+        }
+
+        if (!has[PerfCycles]) {
+            std::fprintf(out, "perf counters unavailable%s%s\n",
+                         error ? ": " : "", error ? std::strerror(error) : "");
+        }
+        std::fprintf(out, "%-32s %8s %10s %10s %6s %10s %10s %10s\n",
+                     "scope", "calls", "ents/call", "Mcycles", "IPC",
+                     "L1D/ent", "LLC/ent", "brmiss/ent");
+        // A counter the CPU doesn't have, or a ratio without a base, is a -
+        auto field {
+            [out](bool valid, double value, int width) {
+                if (valid) {
+                    std::fprintf(out, " %*.2f", width, value);
+                } else {
+                    std::fprintf(out, " %*s", width, "-");
+                }
+            }
+        };
+        for (const auto& total : totals) {
+            const auto& cycles { total.counts[PerfCycles] };
+            const auto  ents   { double(total.entities) };
+            std::fprintf(out, "%-32s %8llu %10.1f", total.name,
+                         static_cast<unsigned long long>(total.calls),
+                         total.calls ? ents / double(total.calls) : 0.0);
+            field(has[PerfCycles], cycles / 1e6, 10);
+            field(has[PerfInstructions] && cycles > 0.0,
+                  total.counts[PerfInstructions] / cycles, 6);
+            for (const auto c : { PerfL1DMisses, PerfLLCMisses,
+                                  PerfBranchMisses }) {
+                field(has[c] && ents > 0.0, total.counts[c] / ents, 10);
+            }
+            std::fprintf(out, "\n");
+        }
+    }
+
+    auto Reset() -> void
+    {
+        std::lock_guard lock { mMutex };
+        for (auto& thread : mThreads) {
+            thread->stats.clear();
+        }
+    }
+
+private:
+
+    PerfCounters_t() = default;
+
+    auto Register() -> PerfThread_t*
+    {
+        std::lock_guard lock { mMutex };
+        mThreads.push_back(std::make_unique<PerfThread_t>());
+        return mThreads.back().get();
+    }
+
+    mutable std::mutex                         mMutex   {  };
+    std::vector<std::unique_ptr<PerfThread_t>> mThreads {  };
+};
+
+// The counts are scaled by the time the group was on the CPU, the kernel
+// multiplexes the groups when there are more than the CPU has counters
+class PerfScope_t final
+{
+
+public:
+
+    PerfScope_t(const char* name, std::uint64_t entities)
+    : mThread   { PerfCounters_t::GetThread() },
+      mName     { name },
+      mEntities { entities }
+    {
+        mCounting = mThread.group.Read(mBegin);
+    }
+
+    ~PerfScope_t()
+    {
+        PerfCounterGroup_t::Sample_t end {  };
+        const bool counted { mCounting && mThread.group.Read(end) };
+        auto& stat { mThread.GetStat(mName) };
+        ++stat.calls;
+        stat.entities += mEntities;
+        if (!counted) {
+            return;
+        }
+
+        const auto enabled { end.enabled - mBegin.enabled };
+        const auto running { end.running - mBegin.running };
+        if (running == 0) {
+            return;
+        }
+        const auto scale { double(enabled) / double(running) };
+        for (std::size_t c { 0 }; c < PerfCounterCount; ++c) {
+            stat.counts[c] += double(end.values[c] - mBegin.values[c]) * scale;
+        }
+    }
+
+    PerfScope_t(const PerfScope_t&) = delete;
+    auto operator=(const PerfScope_t&) -> PerfScope_t& = delete;
+
+private:
+
+    PerfThread_t&                mThread;
+    const char*                  mName     {  };
+    std::uint64_t                mEntities {  };
+    bool                         mCounting {  };
+    PerfCounterGroup_t::Sample_t mBegin    {  };
+};
+
+} // namespace ECS
+
+#else
+
+#define ECS_PERF_SCOPE(name, entities) static_cast<void>(0)
+
+#endif
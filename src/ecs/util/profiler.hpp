@@ -0,0 +1,201 @@
+#pragma once
+
+// Scoped timings of the systems and of the loops of the manager, built with
+// ECS_PROFILE defined (make PROFILE=1). Without it the macros are empty and
+// their arguments aren't evaluated
+//
+// ECS_PROFILE_SCOPE(name)               times the rest of the block
+// ECS_PROFILE_SCOPE_COUNT(name, count)  same, with the entities it handles
+//
+// The name must be a string literal, only the pointer is kept
+
+#ifdef ECS_PROFILE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define ECS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ECS_PROFILE_CONCAT(a, b)      ECS_PROFILE_CONCAT_IMPL(a, b)
+
+#define ECS_PROFILE_SCOPE(name)                                              \
+    const ::ECS::ProfileScope_t ECS_PROFILE_CONCAT(ecs_profile_, __LINE__)   \
+    { name }
+
+#define ECS_PROFILE_SCOPE_COUNT(name, count)                                 \
+    const ::ECS::ProfileScope_t ECS_PROFILE_CONCAT(ecs_profile_, __LINE__)   \
+    { name, static_cast<std::uint64_t>(count) }
+
+namespace ECS
+{
+
+struct ProfileEvent_t
+{
+    const char*   name  {  };
+    std::uint64_t begin {  };
+    std::uint64_t end   {  };
+    std::uint64_t count {  };
+};
+
+inline auto ProfileNow() -> std::uint64_t
+{
+    return static_cast<std::uint64_t>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+               .count());
+}
+
+// The last Capacity events of one thread. Only that thread writes, the head
+// is published after the event so a reader sees whole events
+class ProfileRing_t final
+{
+
+public:
+
+    constexpr static inline std::size_t Capacity { 1 << 15 };
+
+    explicit ProfileRing_t(std::size_t tid) : mThreadID { tid } {  }
+
+    auto Push(const ProfileEvent_t& event) -> void
+    {
+        const auto head { mHead.load(std::memory_order_relaxed) };
+        mEvents[head & (Capacity - 1)] = event;
+        mHead.store(head + 1, std::memory_order_release);
+    }
+
+    template<class Callable_t>
+    auto ForEachEvent(Callable_t&& callable) const -> void
+    {
+        const auto head  { mHead.load(std::memory_order_acquire) };
+        const auto first { head > Capacity ? head - Capacity : 0 };
+        for (auto i { first }; i < head; ++i) {
+            callable(mEvents[i & (Capacity - 1)]);
+        }
+    }
+
+    constexpr auto GetThreadID() const -> std::size_t { return mThreadID; }
+
+private:
+
+    std::array<ProfileEvent_t, Capacity> mEvents   {  };
+    std::atomic<std::uint64_t>           mHead     { 0 };
+    std::size_t                          mThreadID {  };
+};
+
+// Owns the rings of every thread that opened a scope, a thread gets its ring
+// the first time. The rings outlive the threads so their events stay
+class Profiler_t final
+{
+
+public:
+
+    static auto Get() -> Profiler_t&
+    {
+        static Profiler_t profiler {  };
+        return profiler;
+    }
+
+    static auto GetThreadRing() -> ProfileRing_t&
+    {
+        thread_local ProfileRing_t* ring { Get().Register() };
+        return *ring;
+    }
+
+    // Chrome trace events, one complete event for each scope with the
+    // entities as argument, open it in chrome://tracing or Perfetto. The
+    // scopes still running on other threads may overwrite the oldest events
+    // while they are read, call it between frames
+    auto WriteChromeTrace(const char* path) const -> bool
+    {
+        std::FILE* file { std::fopen(path, "w") };
+        if (!file) {
+            return false;
+        }
+
+        std::lock_guard lock { mMutex };
+        auto origin { ~std::uint64_t{ 0 } };
+        for (const auto& ring : mRings) {
+            ring->ForEachEvent([&origin](const ProfileEvent_t& event) {
+                origin = std::min(origin, event.begin);
+            });
+        }
+
+        std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        const char* sep { "\n" };
+        for (const auto& ring : mRings) {
+            const auto tid { ring->GetThreadID() };
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\","
+                               "\"pid\":0,\"tid\":%zu,"
+                               "\"args\":{\"name\":\"thread %zu\"}}",
+                         sep, tid, tid);
+            sep = ",\n";
+            ring->ForEachEvent([file, tid, origin](const ProfileEvent_t& ev) {
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\","
+                                   "\"pid\":0,\"tid\":%zu,"
+                                   "\"ts\":%.3f,\"dur\":%.3f,"
+                                   "\"args\":{\"entities\":%llu}}",
+                             ev.name, tid,
+                             double(ev.begin - origin) / 1e3,
+                             double(ev.end - ev.begin) / 1e3,
+                             static_cast<unsigned long long>(ev.count));
+            });
+        }
+        std::fprintf(file, "\n]}\n");
+        return std::fclose(file) == 0;
+    }
+
+private:
+
+    Profiler_t() = default;
+
+    auto Register() -> ProfileRing_t*
+    {
+        std::lock_guard lock { mMutex };
+        mRings.push_back(std::make_unique<ProfileRing_t>(mRings.size()));
+        return mRings.back().get();
+    }
+
+    mutable std::mutex                          mMutex {  };
+    std::vector<std::unique_ptr<ProfileRing_t>> mRings {  };
+};
+
+class ProfileScope_t final
+{
+
+public:
+
+    explicit ProfileScope_t(const char* name, std::uint64_t count = 0)
+    : mName  { name },
+      mCount { count },
+      mBegin { ProfileNow() } {  }
+
+    ~ProfileScope_t()
+    {
+        Profiler_t::GetThreadRing().Push({ mName, mBegin, ProfileNow(),
+                                           mCount });
+    }
+
+    ProfileScope_t(const ProfileScope_t&) = delete;
+    auto operator=(const ProfileScope_t&) -> ProfileScope_t& = delete;
+
+private:
+
+    const char*   mName  {  };
+    std::uint64_t mCount {  };
+    std::uint64_t mBegin {  };
+};
+
+} // namespace ECS
+
+#else
+
+#define ECS_PROFILE_SCOPE(name)              static_cast<void>(0)
+#define ECS_PROFILE_SCOPE_COUNT(name, count) static_cast<void>(0)
+
+#endif
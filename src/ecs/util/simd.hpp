@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ECS_SIMD_X86 1
+#endif
+
+namespace ECS
+{
+
+// Widest instruction set the kernels can use on this CPU, checked once at
+// runtime so a build without -march=native still gets the wide paths
+enum class SimdLevel_t { Scalar, SSE2, AVX2 };
+
+inline auto DetectSimdLevel() -> SimdLevel_t
+{
+#ifdef ECS_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel_t::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel_t::SSE2;
+    }
+#endif
+    return SimdLevel_t::Scalar;
+}
+
+inline auto GetSimdLevel() -> SimdLevel_t
+{
+    static const SimdLevel_t level { DetectSimdLevel() };
+    return level;
+}
+
+inline auto SimdLevelName(SimdLevel_t level) -> const char*
+{
+    switch (level) {
+        case SimdLevel_t::AVX2: return "avx2";
+        case SimdLevel_t::SSE2: return "sse2";
+        default:                return "scalar";
+    }
+}
+
+// dst[i] += src[i] for i in [0, n)
+inline auto AddInPlaceScalar(std::int32_t* dst,
+                             const std::int32_t* src,
+                             std::size_t n)
+-> void
+{
+    for (std::size_t i { 0 }; i < n; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+#ifdef ECS_SIMD_X86
+
+// 16 lanes for each iteration in four 128 bits adds
+__attribute__((target("sse2")))
+inline auto AddInPlaceSSE2(std::int32_t* dst,
+                           const std::int32_t* src,
+                           std::size_t n)
+-> void
+{
+    std::size_t i { 0 };
+    for (; i + 16 <= n; i += 16) {
+        auto* d { reinterpret_cast<__m128i*>(dst + i) };
+        auto* s { reinterpret_cast<const __m128i*>(src + i) };
+        const auto a { _mm_add_epi32(_mm_loadu_si128(d),
+                                     _mm_loadu_si128(s)) };
+        const auto b { _mm_add_epi32(_mm_loadu_si128(d + 1),
+                                     _mm_loadu_si128(s + 1)) };
+        const auto c { _mm_add_epi32(_mm_loadu_si128(d + 2),
+                                     _mm_loadu_si128(s + 2)) };
+        const auto e { _mm_add_epi32(_mm_loadu_si128(d + 3),
+                                     _mm_loadu_si128(s + 3)) };
+        _mm_storeu_si128(d,     a);
+        _mm_storeu_si128(d + 1, b);
+        _mm_storeu_si128(d + 2, c);
+        _mm_storeu_si128(d + 3, e);
+    }
+    AddInPlaceScalar(dst + i, src + i, n - i);
+}
+
+// 16 lanes for each iteration in two 256 bits adds
+__attribute__((target("avx2")))
+inline auto AddInPlaceAVX2(std::int32_t* dst,
+                           const std::int32_t* src,
+                           std::size_t n)
+-> void
+{
+    std::size_t i { 0 };
+    for (; i + 16 <= n; i += 16) {
+        auto* d { reinterpret_cast<__m256i*>(dst + i) };
+        auto* s { reinterpret_cast<const __m256i*>(src + i) };
+        const auto a { _mm256_add_epi32(_mm256_loadu_si256(d),
+                                        _mm256_loadu_si256(s)) };
+        const auto b { _mm256_add_epi32(_mm256_loadu_si256(d + 1),
+                                        _mm256_loadu_si256(s + 1)) };
+        _mm256_storeu_si256(d,     a);
+        _mm256_storeu_si256(d + 1, b);
+    }
+    AddInPlaceScalar(dst + i, src + i, n - i);
+}
+
+#endif
+
+inline auto AddInPlace(SimdLevel_t level,
+                       std::int32_t* dst,
+                       const std::int32_t* src,
+                       std::size_t n)
+-> void
+{
+#ifdef ECS_SIMD_X86
+    switch (level) {
+        case SimdLevel_t::AVX2: AddInPlaceAVX2(dst, src, n); return;
+        case SimdLevel_t::SSE2: AddInPlaceSSE2(dst, src, n); return;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    AddInPlaceScalar(dst, src, n);
+}
+
+inline auto AddInPlace(std::int32_t* dst,
+                       const std::int32_t* src,
+                       std::size_t n)
+-> void
+{
+    AddInPlace(GetSimdLevel(), dst, src, n);
+}
+
+} // namespace ECS
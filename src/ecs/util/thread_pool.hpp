@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <ecs/util/type_aliases.hpp>
+#include <ecs/util/helpers.hpp>
+
+namespace ECS
+{
+
+constexpr inline std::size_t CacheLineSize { 64 };
+
+// Rows [0, size) split in chunks that start on a cache line, so two threads
+// never write to the same line. The head is the chunk of rows before the
+// first row that starts a line
+struct CacheAlignedChunks_t
+{
+    std::size_t head  {  };
+    std::size_t chunk { 1 };
+    std::size_t size  {  };
+
+    constexpr auto GetCount() const -> std::size_t
+    {
+        return (head ? 1 : 0) + (size - head + chunk - 1) / chunk;
+    }
+
+    constexpr auto GetBegin(std::size_t c) const -> std::size_t
+    {
+        if (head) {
+            return c == 0 ? 0 : head + (c - 1) * chunk;
+        }
+        return c * chunk;
+    }
+
+    constexpr auto GetEnd(std::size_t c) const -> std::size_t
+    {
+        if (head && c == 0) {
+            return head;
+        }
+        return std::min(GetBegin(c) + chunk, size);
+    }
+};
+
+// The chunk is rounded up to the smallest number of rows that spans whole
+// cache lines, so once the first boundary is aligned all of them are
+template<class Row_t>
+auto SplitInCacheAlignedChunks(const Row_t* rows,
+                               std::size_t size,
+                               std::size_t grain)
+-> CacheAlignedChunks_t
+{
+    constexpr std::size_t rows_per_lines
+    {
+        CacheLineSize / std::gcd(CacheLineSize, sizeof(Row_t))
+    };
+
+    CacheAlignedChunks_t chunks {  };
+    chunks.size  = size;
+    chunks.chunk = std::max(grain, std::size_t{ 1 });
+    chunks.chunk = (chunks.chunk + rows_per_lines - 1)
+                 / rows_per_lines * rows_per_lines;
+
+    const auto max_head { std::min(size, rows_per_lines) };
+    for (std::size_t i { 0 }; i < max_head; ++i) {
+        if (reinterpret_cast<std::uintptr_t>(rows + i) % CacheLineSize == 0) {
+            chunks.head = i;
+            break;
+        }
+    }
+    return chunks;
+}
+
+// Persistent workers that run the tasks of one ParallelFor at a time, the
+// tasks are split evenly between the queues of the threads and a thread with
+// an empty queue steals from the back of the others
+class ThreadPool_t final : Uncopyable_t
+{
+
+public:
+
+    // The calling thread counts as one of the threads of the pool
+    explicit ThreadPool_t(std::size_t n_threads = DefaultThreadCount())
+    : mThreadCount { n_threads ? n_threads : 1 },
+      mQueues      ( mThreadCount )
+    {
+        mWorkers.reserve(mThreadCount - 1);
+        for (std::size_t i { 1 }; i < mThreadCount; ++i) {
+            mWorkers.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    }
+
+    ~ThreadPool_t()
+    {
+        {
+            std::lock_guard lock { mMutex };
+            mStop = true;
+        }
+        mWake.notify_all();
+        for (auto& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    static auto DefaultThreadCount() -> std::size_t
+    {
+        const auto n_threads { std::thread::hardware_concurrency() };
+        return n_threads ? n_threads : 1;
+    }
+
+    // Shared by every manager that doesn't bring its own pool
+    static auto GetDefault() -> ThreadPool_t&
+    {
+        static ThreadPool_t pool {  };
+        return pool;
+    }
+
+    constexpr auto GetThreadCount() const -> std::size_t
+    {
+        return mThreadCount;
+    }
+
+    // Calls callable(task) for every task in [0, n_tasks) and returns when
+    // all of them are done, the calling thread runs tasks too. A ParallelFor
+    // called while the pool is busy, e.g. from one of its tasks, runs inline
+    template<class Callable_t>
+    auto ParallelFor(std::size_t n_tasks, Callable_t&& callable) -> void
+    {
+        if (mThreadCount == 1 || n_tasks <= 1
+            || mInUse.exchange(true, std::memory_order_acquire)) {
+            for (std::size_t task { 0 }; task < n_tasks; ++task) {
+                callable(task);
+            }
+            return;
+        }
+
+        const auto per_queue { n_tasks / mThreadCount };
+        const auto remainder { n_tasks % mThreadCount };
+        std::size_t begin { 0 };
+        for (std::size_t q { 0 }; q < mThreadCount; ++q) {
+            const auto end { begin + per_queue + (q < remainder ? 1 : 0) };
+            mQueues[q].Reset(begin, end);
+            begin = end;
+        }
+
+        using Func_t = std::remove_reference_t<Callable_t>;
+        mTaskCtx  = const_cast<void*>(static_cast<const void*>(&callable));
+        mTaskFunc = [](void* ctx, std::size_t task) {
+            (*static_cast<Func_t*>(ctx))(task);
+        };
+        mPending.store(n_tasks, std::memory_order_relaxed);
+
+        {
+            std::lock_guard lock { mMutex };
+            mBusyWorkers = mWorkers.size();
+            ++mJob;
+        }
+        mWake.notify_all();
+
+        RunTasks(0);
+
+        // The workers may still be looking for work to steal, the next job
+        // can't be published until all of them are back to sleep
+        while (mPending.load(std::memory_order_acquire) != 0
+               || mBusyWorkers.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        mInUse.store(false, std::memory_order_release);
+    }
+
+private:
+
+    struct alignas(CacheLineSize) Queue_t
+    {
+        auto Reset(std::size_t begin, std::size_t end) -> void
+        {
+            std::lock_guard lock { mutex };
+            front = begin;
+            back  = end;
+        }
+
+        auto PopFront(std::size_t& task) -> bool
+        {
+            std::lock_guard lock { mutex };
+            if (front == back) {
+                return false;
+            }
+            task = front++;
+            return true;
+        }
+
+        auto PopBack(std::size_t& task) -> bool
+        {
+            std::lock_guard lock { mutex };
+            if (front == back) {
+                return false;
+            }
+            task = --back;
+            return true;
+        }
+
+        std::mutex  mutex {  };
+        std::size_t front {  };
+        std::size_t back  {  };
+    };
+
+    auto WorkerLoop(std::size_t index) -> void
+    {
+        std::size_t seen_job { 0 };
+        while (true) {
+            {
+                std::unique_lock lock { mMutex };
+                mWake.wait(lock, [this, seen_job] {
+                    return mStop || mJob != seen_job;
+                });
+                if (mStop) {
+                    return;
+                }
+                seen_job = mJob;
+            }
+            RunTasks(index);
+            mBusyWorkers.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    auto RunTasks(std::size_t index) -> void
+    {
+        std::size_t task {  };
+        while (PopTask(index, task)) {
+            mTaskFunc(mTaskCtx, task);
+            mPending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    auto PopTask(std::size_t index, std::size_t& task) -> bool
+    {
+        if (mQueues[index].PopFront(task)) {
+            return true;
+        }
+        for (std::size_t i { 1 }; i < mThreadCount; ++i) {
+            if (mQueues[(index + i) % mThreadCount].PopBack(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::size_t          mThreadCount {  };
+    Storage_t<Queue_t>         mQueues      {  };
+    Storage_t<std::thread>     mWorkers     {  };
+
+    std::mutex              mMutex {  };
+    std::condition_variable mWake  {  };
+    std::size_t             mJob   {  };
+    bool                    mStop  { false };
+
+    void*  mTaskCtx                          {  };
+    void (*mTaskFunc)(void*, std::size_t)    {  };
+    std::atomic<std::size_t> mPending        {  };
+    std::atomic<std::size_t> mBusyWorkers    {  };
+    std::atomic<bool>        mInUse          { false };
+};
+
+} // namespace ECS
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -13,9 +15,16 @@
 namespace ECS
 {
 
-using EntityID_t        = std::size_t;
-using ComponentID_t     = std::size_t;
-using ComponentTypeID_t = std::size_t;
+using EntityID_t         = std::uint32_t;
+using EntityGeneration_t = std::uint32_t;
+using ComponentID_t      = std::size_t;
+using ComponentTypeID_t  = std::size_t;
+
+// The ID of a slot that has no alive entity
+constexpr inline EntityID_t InvalidEntityID
+{
+    std::numeric_limits<EntityID_t>::max()
+};
 
 template<typename T>
 using Storage_t         = std::vector<T>;
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 struct BoundingBox_t
@@ -13,11 +15,160 @@ struct BoundingBox_t
 
 struct BoundingBoxNode_t
 {
+    // The children arrays of the whole subtree
+    auto GetHeapBytes() const -> std::size_t
+    {
+        auto bytes { root.capacity() * sizeof(BoundingBoxNode_t) };
+        for (const auto& child : root) {
+            bytes += child.GetHeapBytes();
+        }
+        return bytes;
+    }
+
     std::vector<BoundingBoxNode_t> root {  };
     BoundingBox_t box {  };
     bool collided { false };
 };
 
+// Node of a BoundingBoxTree_t, skip is the index of the first node after its
+// subtree, so a leaf has skip == index + 1
+struct FlatBoxNode_t
+{
+    BoundingBox_t box   {  };
+    std::uint32_t skip  {  };
+    std::uint32_t depth {  };
+};
+
+// The nodes of a BoundingBoxNode_t tree in depth first order in one array,
+// the collided flags live in their own bitset. The boxes of the children of
+// node i are also kept side by side as structure of arrays in the slots
+// [child_begin[i], child_begin[i + 1]), so a box is tested against all of
+// them at once. The arrays of the slots share one block of slot_stride
+// entries each
+struct BoundingBoxTree_t
+{
+    // Extra slots at the end so the wide kernels can always load 8 lanes
+    constexpr static inline std::size_t SlotPadding { 7 };
+
+    enum SlotField_t : std::size_t
+    {
+        SlotXLeft,
+        SlotXRight,
+        SlotYUp,
+        SlotYDown,
+        SlotNode,
+        SlotFieldCount
+    };
+
+    void Build(const BoundingBoxNode_t& root)
+    {
+        nodes.clear();
+        Append(root, 0);
+        collided.assign((nodes.size() + 63) / 64, 0);
+        BuildChildSlots();
+    }
+
+    auto GetChildCount(std::uint32_t i) const -> std::uint32_t
+    {
+        return child_begin[i + 1] - child_begin[i];
+    }
+
+    auto GetSlots(SlotField_t field) const -> const std::uint32_t*
+    {
+        return slots.data() + field * slot_stride;
+    }
+
+    auto IsBuilt() const -> bool { return !nodes.empty(); }
+
+    auto IsLeaf(std::uint32_t i) const -> bool
+    {
+        return nodes[i].skip == i + 1;
+    }
+
+    auto IsCollided(std::uint32_t i) const -> bool
+    {
+        return (collided[i / 64] >> (i % 64)) & 1;
+    }
+
+    void SetCollided(std::uint32_t i)
+    {
+        collided[i / 64] |= std::uint64_t{ 1 } << (i % 64);
+    }
+
+    void ResetCollided()
+    {
+        for (auto& word : collided) {
+            word = 0;
+        }
+    }
+
+    // Only the leaves are ever flagged
+    auto AnyLeafCollided() const -> bool
+    {
+        for (const auto word : collided) {
+            if (word) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto GetHeapBytes() const -> std::size_t
+    {
+        return nodes.capacity()       * sizeof(FlatBoxNode_t)
+             + collided.capacity()    * sizeof(std::uint64_t)
+             + child_begin.capacity() * sizeof(std::uint32_t)
+             + slots.capacity()       * sizeof(std::uint32_t);
+    }
+
+    std::vector<FlatBoxNode_t> nodes        {  };
+    std::vector<std::uint64_t> collided     {  };
+    std::vector<std::uint32_t> child_begin  {  };
+    std::vector<std::uint32_t> slots        {  };
+    std::size_t                slot_stride  {  };
+    std::uint32_t              max_children {  };
+
+private:
+    // Every node but the root is the child of one node
+    void BuildChildSlots()
+    {
+        const auto n { static_cast<std::uint32_t>(nodes.size()) };
+        slot_stride = n - 1 + SlotPadding;
+        slots.assign(SlotFieldCount * slot_stride, 0);
+        child_begin.assign(n + 1, 0);
+
+        std::uint32_t slot { 0 };
+        for (std::uint32_t i { 0 }; i < n; ++i) {
+            child_begin[i] = slot;
+            for (auto c { i + 1 }; c < nodes[i].skip; c = nodes[c].skip) {
+                const auto& box { nodes[c].box };
+                slots[SlotXLeft  * slot_stride + slot] = box.xLeft;
+                slots[SlotXRight * slot_stride + slot] = box.xRight;
+                slots[SlotYUp    * slot_stride + slot] = box.yUp;
+                slots[SlotYDown  * slot_stride + slot] = box.yDown;
+                slots[SlotNode   * slot_stride + slot] = c;
+                ++slot;
+            }
+        }
+        child_begin[n] = slot;
+
+        max_children = 0;
+        for (std::uint32_t i { 0 }; i < n; ++i) {
+            max_children = std::max(max_children, GetChildCount(i));
+        }
+    }
+
+    void Append(const BoundingBoxNode_t& node, std::uint32_t depth)
+    {
+        const auto index { static_cast<std::uint32_t>(nodes.size()) };
+        nodes.push_back({ node.box, 0, depth });
+        for (const auto& child : node.root) {
+            Append(child, depth + 1);
+        }
+        nodes[index].skip = static_cast<std::uint32_t>(nodes.size());
+    }
+};
+
 struct ColliderComponent_t
 {
     enum
@@ -30,4 +181,19 @@ struct ColliderComponent_t
 
     BoundingBoxNode_t BoxRoot {  };
     std::uint8_t mask { LALL };
+
+    // A static collider doesn't move, the collider system keeps it in a tree
+    // that is only built again when the static colliders change, and never
+    // checks two of them against each other
+    bool is_static { false };
+
+    // Built from BoxRoot, the systems only walk this one. The collider
+    // system builds it the first time it sees the component, after that a
+    // change of BoxRoot needs a new Build
+    BoundingBoxTree_t BoxTree {  };
+
+    auto GetHeapBytes() const -> std::size_t
+    {
+        return BoxRoot.GetHeapBytes() + BoxTree.GetHeapBytes();
+    }
 };
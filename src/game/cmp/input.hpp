@@ -1,11 +1,11 @@
 #pragma once
 
-#include <raylib.h>
+#include <game/platform/types.hpp>
 
 struct InputComponent_t
 {
-    KeyboardKey k_left  { KEY_A };
-    KeyboardKey k_right { KEY_D };
-    KeyboardKey k_up    { KEY_W };
-    KeyboardKey k_down  { KEY_S };
+    Key_t k_left  { Key_t::A };
+    Key_t k_right { Key_t::D };
+    Key_t k_up    { Key_t::W };
+    Key_t k_down  { Key_t::S };
 };
@@ -2,6 +2,10 @@
 
 #include "math_vector.hpp"
 
+#include <tuple>
+
+#include <ecs/cmp/soa_layout.hpp>
+
 using VecInt = Vector_t<int>;
 
 struct PhysicsComponent_t
@@ -9,3 +13,23 @@ struct PhysicsComponent_t
     VecInt pos {  };
     VecInt vel {  };
 };
+
+// What the systems get instead of PhysicsComponent_t& when the pool splits
+// pos and vel in their own arrays
+template<class Vec_t>
+struct PhysicsRef_t
+{
+    Vec_t& pos;
+    Vec_t& vel;
+};
+
+template<>
+struct ECS::SoALayout_t<PhysicsComponent_t>
+{
+    constexpr static inline auto Fields
+    {
+        std::make_tuple(&PhysicsComponent_t::pos, &PhysicsComponent_t::vel)
+    };
+    using Ref_t      = PhysicsRef_t<VecInt>;
+    using ConstRef_t = PhysicsRef_t<const VecInt>;
+};
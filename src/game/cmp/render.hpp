@@ -1,13 +1,12 @@
 #pragma once
 
-#include <functional>
-#include <raylib.h>
+#include <game/platform/types.hpp>
 
 struct RenderComponent_t
 {
-    RenderComponent_t(Texture2D& sp, float sz)
+    RenderComponent_t(const Texture_t& sp, float sz)
         : sprite { sp }, wh { sp.width / sz, sp.height / sz } {  }
 
-    std::reference_wrapper<Texture2D> sprite;
-    Vector2 wh {  };
+    Texture_t sprite {  };
+    VecFloat  wh     {  };
 };
@@ -1,14 +1,57 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 struct SpawnComponent_t
 {
     using Clock = std::chrono::steady_clock;
 
-    std::function<void(int x, int y)> spawn_callable {  };
+    SpawnComponent_t() = default;
+
+    template<class Callable_t,
+             class = std::enable_if_t<!std::is_same_v<std::decay_t<Callable_t>,
+                                                      SpawnComponent_t>>>
+    explicit SpawnComponent_t(Callable_t&& callable)
+    {
+        SetSpawnCallable(std::forward<Callable_t>(callable));
+    }
+
+    // The std::function hides the callable, its size is taken when it's
+    // given, so both are only changed here
+    template<class Callable_t>
+    void SetSpawnCallable(Callable_t&& callable)
+    {
+        m_SpawnCallable     = std::forward<Callable_t>(callable);
+        m_CallableHeapBytes = CallableHeapBytes<std::decay_t<Callable_t>>();
+    }
+
+    void Spawn(int x, int y) const { m_SpawnCallable(x, y); }
+
+    auto GetHeapBytes() const -> std::size_t { return m_CallableHeapBytes; }
+
     Clock::time_point last_spawn_time { Clock::now() };
     std::chrono::duration<float> spawn_interval { std::chrono::seconds { 5 } };
     unsigned to_be_spawned { 2 }; 
+
+private:
+    // Follows the small buffer of libstdc++: two pointers, and only for the
+    // trivially copyable callables. Other standard libraries size it their
+    // own way, with them the bytes reported are an estimate
+    template<class Fn_t>
+    constexpr static auto CallableHeapBytes() -> std::size_t
+    {
+        constexpr bool in_place
+        {
+            sizeof(Fn_t) <= 2 * sizeof(void*)
+            && std::is_trivially_copyable_v<Fn_t>
+        };
+        return in_place ? 0 : sizeof(Fn_t);
+    }
+
+    std::function<void(int x, int y)> m_SpawnCallable     {  };
+    std::size_t                       m_CallableHeapBytes {  };
 };
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <utility>
+
+// Backend without window, input or drawing, the game runs as fast as the
+// simulation allows for the frames given, forever with 0. The textures only
+// get their size, read from the header of the PNG, the random values come
+// from a fixed seed so two runs are the same
+class NullPlatform_t
+{
+public:
+    // Used when the file isn't there or isn't a PNG
+    constexpr static inline int DefaultTextureSize { 64 };
+
+    explicit NullPlatform_t(std::uint64_t frames = 0,
+                            std::uint32_t seed   = 1)
+        : m_Frames { frames }, m_Random { seed } {  }
+
+    void OpenWindow(unsigned, unsigned, const char*) {  }
+    void CloseWindow() {  }
+
+    auto ShouldClose() const -> bool
+    {
+        return m_Frames != 0 && m_Drawn >= m_Frames;
+    }
+
+    auto IsKeyDown(Key_t) const -> bool { return false; }
+
+    auto GetRandomValue(int min, int max) -> int
+    {
+        if (min > max) {
+            std::swap(min, max);
+        }
+        const auto range
+        {
+            static_cast<std::uint32_t>(max) - static_cast<std::uint32_t>(min)
+        };
+        return static_cast<int>(static_cast<std::uint32_t>(min)
+                                + m_Random() % (std::uint64_t{ range } + 1));
+    }
+
+    auto LoadTexture(const char* path) -> Texture_t
+    {
+        Texture_t tex { m_Textures++, DefaultTextureSize, DefaultTextureSize };
+        ReadPNGSize(path, tex);
+        return tex;
+    }
+
+    void BeginDrawing() {  }
+    void EndDrawing() { ++m_Drawn; }
+    void ClearBackground(Color_t) {  }
+    void DrawFPS(int, int) {  }
+    void DrawTexturePro(const Texture_t&, const Rect_t&, const Rect_t&,
+                        VecFloat, float, Color_t) {  }
+    void DrawRectangle(const Rect_t&, Color_t) {  }
+    void DrawRectangleLines(const Rect_t&, float, Color_t) {  }
+
+    auto GetFrameCount() const -> std::uint64_t { return m_Drawn; }
+
+private:
+    // The width and height are the first fields of the IHDR chunk, which
+    // follows the 8 bytes of the signature and the 8 of the chunk header
+    static void ReadPNGSize(const char* path, Texture_t& tex)
+    {
+        std::ifstream file { path, std::ios::binary };
+        unsigned char header[24] {  };
+        if (!file.read(reinterpret_cast<char*>(header), sizeof(header))
+            || header[1] != 'P' || header[2] != 'N' || header[3] != 'G') {
+            return;
+        }
+        auto be32 {
+            [&header](std::size_t at) {
+                return static_cast<int>(std::uint32_t{ header[at] } << 24
+                                        | std::uint32_t{ header[at + 1] } << 16
+                                        | std::uint32_t{ header[at + 2] } << 8
+                                        | std::uint32_t{ header[at + 3] });
+            }
+        };
+        tex.width  = be32(16);
+        tex.height = be32(20);
+    }
+
+    std::uint64_t    m_Frames   {  };
+    std::uint64_t    m_Drawn    {  };
+    std::uint32_t    m_Textures {  };
+    std::minstd_rand m_Random   {  };
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <raylib.h>
+
+// The only backend that needs raylib, the window is opened and closed by
+// the render system and the textures live here until it closes
+class RaylibPlatform_t
+{
+public:
+    void OpenWindow(unsigned wh, unsigned hg, const char* name)
+    {
+        InitWindow(wh, hg, name);
+        SetTargetFPS(60);
+    }
+
+    // The textures go with the context of the window
+    void CloseWindow()
+    {
+        for (const auto& tex : m_Textures) {
+            UnloadTexture(tex);
+        }
+        m_Textures.clear();
+        ::CloseWindow();
+    }
+
+    auto ShouldClose() const -> bool { return WindowShouldClose(); }
+
+    auto IsKeyDown(Key_t key) const -> bool
+    {
+        return ::IsKeyDown(static_cast<int>(key));
+    }
+
+    auto GetRandomValue(int min, int max) -> int
+    {
+        return ::GetRandomValue(min, max);
+    }
+
+    auto LoadTexture(const char* path) -> Texture_t
+    {
+        const auto id { static_cast<std::uint32_t>(m_Textures.size()) };
+        m_Textures.push_back(::LoadTexture(path));
+        return { id, m_Textures.back().width, m_Textures.back().height };
+    }
+
+    void BeginDrawing() { ::BeginDrawing(); }
+    void EndDrawing() { ::EndDrawing(); }
+
+    void ClearBackground(Color_t color)
+    {
+        ::ClearBackground(ToRaylib(color));
+    }
+
+    void DrawFPS(int x, int y) { ::DrawFPS(x, y); }
+
+    void DrawTexturePro(const Texture_t& tex, const Rect_t& src,
+                        const Rect_t& dest, VecFloat origin,
+                        float rotation, Color_t tint)
+    {
+        ::DrawTexturePro(m_Textures[tex.id], ToRaylib(src), ToRaylib(dest),
+                         Vector2{ origin.x, origin.y }, rotation,
+                         ToRaylib(tint));
+    }
+
+    void DrawRectangle(const Rect_t& rec, Color_t color)
+    {
+        ::DrawRectangle(static_cast<int>(rec.x), static_cast<int>(rec.y),
+                        static_cast<int>(rec.width),
+                        static_cast<int>(rec.height), ToRaylib(color));
+    }
+
+    void DrawRectangleLines(const Rect_t& rec, float thick, Color_t color)
+    {
+        ::DrawRectangleLinesEx(ToRaylib(rec), thick, ToRaylib(color));
+    }
+
+private:
+    static auto ToRaylib(const Rect_t& rec) -> Rectangle
+    {
+        return { rec.x, rec.y, rec.width, rec.height };
+    }
+
+    static auto ToRaylib(Color_t color) -> Color
+    {
+        return { color.r, color.g, color.b, color.a };
+    }
+
+    std::vector<Texture2D> m_Textures {  };
+};
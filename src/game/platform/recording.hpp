@@ -0,0 +1,66 @@
+#pragma once
+
+#include "null.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Null backend that keeps what the game asked for: the textures it loaded
+// and the draw calls of the last frame. The keys in keys_down are the ones
+// IsKeyDown reports as pressed
+class RecordingPlatform_t : public NullPlatform_t
+{
+public:
+    enum class DrawKind_t : std::uint8_t
+    {
+        Texture,
+        Rectangle,
+        RectangleLines
+    };
+
+    struct DrawCall_t
+    {
+        DrawKind_t    kind    {  };
+        std::uint32_t texture {  };
+        Rect_t        rect    {  };
+        Color_t       color   {  };
+    };
+
+    using NullPlatform_t::NullPlatform_t;
+
+    auto IsKeyDown(Key_t key) const -> bool
+    {
+        return std::find(keys_down.begin(), keys_down.end(), key)
+               != keys_down.end();
+    }
+
+    auto LoadTexture(const char* path) -> Texture_t
+    {
+        loaded.emplace_back(path);
+        return NullPlatform_t::LoadTexture(path);
+    }
+
+    void BeginDrawing() { draws.clear(); }
+
+    void DrawTexturePro(const Texture_t& tex, const Rect_t&,
+                        const Rect_t& dest, VecFloat, float, Color_t tint)
+    {
+        draws.push_back({ DrawKind_t::Texture, tex.id, dest, tint });
+    }
+
+    void DrawRectangle(const Rect_t& rec, Color_t color)
+    {
+        draws.push_back({ DrawKind_t::Rectangle, 0, rec, color });
+    }
+
+    void DrawRectangleLines(const Rect_t& rec, float, Color_t color)
+    {
+        draws.push_back({ DrawKind_t::RectangleLines, 0, rec, color });
+    }
+
+    std::vector<Key_t>       keys_down {  };
+    std::vector<std::string> loaded    {  };
+    std::vector<DrawCall_t>  draws     {  };
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include <math_vector.hpp>
+
+// What the game passes to and gets from a platform backend, none of it
+// needs raylib. A backend is any type with the functions of NullPlatform_t,
+// the systems that talk to it take its type as template parameter
+
+using VecFloat = Vector_t<float>;
+
+// The backend keeps what it loaded, the game only holds the id and the size
+struct Texture_t
+{
+    std::uint32_t id     {  };
+    int           width  {  };
+    int           height {  };
+};
+
+struct Rect_t
+{
+    float x      {  };
+    float y      {  };
+    float width  {  };
+    float height {  };
+};
+
+struct Color_t
+{
+    std::uint8_t r {  };
+    std::uint8_t g {  };
+    std::uint8_t b {  };
+    std::uint8_t a {  };
+
+    // 0xRRGGBBAA, as raylib packs them
+    constexpr auto ToInt() const -> std::uint32_t
+    {
+        return std::uint32_t{ r } << 24 | std::uint32_t{ g } << 16
+             | std::uint32_t{ b } << 8  | std::uint32_t{ a };
+    }
+
+    constexpr static auto FromInt(std::uint32_t hex) -> Color_t
+    {
+        return { static_cast<std::uint8_t>(hex >> 24),
+                 static_cast<std::uint8_t>(hex >> 16),
+                 static_cast<std::uint8_t>(hex >> 8),
+                 static_cast<std::uint8_t>(hex) };
+    }
+};
+
+constexpr inline Color_t WhiteColor { 255, 255, 255, 255 };
+constexpr inline Color_t RedColor   { 230,  41,  55, 255 };
+
+// The values are the key codes of raylib, so its backend passes them as is
+enum class Key_t : int
+{
+    A = 65,
+    D = 68,
+    S = 83,
+    W = 87
+};
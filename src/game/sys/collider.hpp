@@ -2,16 +2,39 @@
 
 #include "sys.hpp"
 
+#include <ecs/util/thread_pool.hpp>
+
 #include <game/cmp/collider.hpp>
 #include <game/cmp/physics.hpp>
+#include <game/util/aabb_simd.hpp>
+#include <game/util/aabb_tree.hpp>
+#include <game/util/broadphase.hpp>
+#include <game/util/contacts.hpp>
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
 struct ColliderSystem_t : SystemBase_t<ColliderComponent_t, PhysicsComponent_t>
 {
-    ColliderSystem_t(unsigned wh, unsigned hg)
-        : width { wh }, height { hg } {  }
+    using SystemResources_t = TMP::TypeList_t<ContactResource_t>;
+
+    // How the pairs of colliders to check are found
+    enum class Broadphase_t
+    {
+        BruteForce,
+        Grid,
+        SweepAndPrune
+    };
+
+    ColliderSystem_t(unsigned wh, unsigned hg,
+                     Broadphase_t bp = Broadphase_t::Grid,
+                     unsigned cell_size = 64)
+        : width { wh }, height { hg }, broadphase { bp },
+          m_Grid { cell_size } {  }
 
     BoundingBox_t Transform2WorldCoordinates(const BoundingBox_t& box,
-                                              const PhysicsComponent_t& phy) const
+                                              const PhysicsRef_t<VecInt>& phy) const
     {
         auto xl { box.xLeft  + phy.pos.x };
         auto xr { box.xRight + phy.pos.x };
@@ -21,9 +44,10 @@ struct ColliderSystem_t : SystemBase_t<ColliderComponent_t, PhysicsComponent_t>
     }
 
     void CheckScreenCollision(const ColliderComponent_t& col,
-                              PhysicsComponent_t& phy) const
+                              const PhysicsRef_t<VecInt>& phy) const
     {
-        auto box { Transform2WorldCoordinates(col.BoxRoot.box, phy) };
+        const auto& root { col.BoxTree.nodes[0].box };
+        auto box { Transform2WorldCoordinates(root, phy) };
         if (box.xRight > width || box.xLeft > width) {
             phy.pos.x -= phy.vel.x;
             phy.vel.x = -phy.vel.x;
@@ -49,73 +73,939 @@ struct ColliderSystem_t : SystemBase_t<ColliderComponent_t, PhysicsComponent_t>
                && range_col(b1.yUp, b1.yDown, b2.yUp, b2.yDown);
     }
 
-    void CheckBoundingBoxNodeCollision(BoundingBoxNode_t& bn1,
-                                       BoundingBoxNode_t& bn2,
-                                       const PhysicsComponent_t& ph1,
-                                       const PhysicsComponent_t& ph2) const
+    // Two leaves that touch, the colliders are indexes of m_Colliders
+    struct LeafContact_t
     {
-        auto bx1 { Transform2WorldCoordinates(bn1.box, ph1) };
-        auto bx2 { Transform2WorldCoordinates(bn2.box, ph2) };
+        std::uint32_t collider1 {  };
+        std::uint32_t collider2 {  };
+        std::uint32_t leaf1     {  };
+        std::uint32_t leaf2     {  };
+    };
 
-        bool collided { CheckBoundingBoxCollision(bx1, bx2) };
+    // What a task of the narrowphase writes, each task has its own so they
+    // share nothing and the merge in task order is the serial order. A
+    // caller of CheckBoundingBoxNodeCollision gives its own too
+    struct NarrowphaseBatch_t
+    {
+        std::vector<LeafContact_t> contacts {  };
+        std::vector<std::uint32_t> stack1   {  };
+        std::vector<std::uint32_t> stack2   {  };
+        std::vector<std::uint32_t> query    {  };
+    };
+
+    // Flags the leaves of both trees that touch, on_contact gets the two
+    // leaves of every hit. It takes the skip walk or the mask descent, see
+    // UseMaskDescent, both flag the same leaves. Only the stacks of the
+    // batch are used
+    template<class OnContact_t = IgnoreContact_t>
+    void CheckBoundingBoxNodeCollision(BoundingBoxTree_t& bt1,
+                                       BoundingBoxTree_t& bt2,
+                                       const PhysicsRef_t<VecInt>& ph1,
+                                       const PhysicsRef_t<VecInt>& ph2,
+                                       NarrowphaseBatch_t& batch,
+                                       OnContact_t on_contact = {  }) const
+    {
+        FindContacts(bt1, bt2, ph1, ph2, batch,
+            [&](std::uint32_t i, std::uint32_t j) {
+                bt1.SetCollided(i);
+                bt2.SetCollided(j);
+                on_contact(i, j);
+            });
+    }
+
+    // Each of the two ways on its own, for bench/narrowphase
+    void CheckBoundingBoxNodeCollisionScalar(BoundingBoxTree_t& bt1,
+                                             BoundingBoxTree_t& bt2,
+                                             const PhysicsRef_t<VecInt>& ph1,
+                                             const PhysicsRef_t<VecInt>& ph2) const
+    {
+        FindContactsWalk(bt1, bt2, ph1, ph2,
+            [&](std::uint32_t i, std::uint32_t j) {
+                bt1.SetCollided(i);
+                bt2.SetCollided(j);
+            });
+    }
+
+    void CheckBoundingBoxNodeCollisionMask(BoundingBoxTree_t& bt1,
+                                           BoundingBoxTree_t& bt2,
+                                           const PhysicsRef_t<VecInt>& ph1,
+                                           const PhysicsRef_t<VecInt>& ph2,
+                                           NarrowphaseBatch_t& batch) const
+    {
+        FindContactsMask(bt1, bt2, ph1, ph2, batch,
+            [&](std::uint32_t i, std::uint32_t j) {
+                bt1.SetCollided(i);
+                bt2.SetCollided(j);
+            });
+    }
+
+    // The skip walk is faster on narrow trees like the one of the player,
+    // the mask descent only wins, at every instruction set, once a node has
+    // this many children, see bench/narrowphase
+    constexpr static inline std::uint32_t MaskMinChildren { 16 };
+
+    static auto UseMaskDescent(const BoundingBoxTree_t& bt1,
+                               const BoundingBoxTree_t& bt2) -> bool
+    {
+        return std::max(bt1.max_children, bt2.max_children) >= MaskMinChildren;
+    }
+
+    // Covers the root box in world coordinates at every position the
+    // collider may have during its pair checks, the screen bounce moves each
+    // axis back by the velocity on its own
+    BoundingBox_t BroadphaseBox(const ColliderComponent_t& col,
+                                const PhysicsRef_t<VecInt>& phy,
+                                const BroadphaseBase_t& bp) const
+    {
+        const auto& box { col.BoxTree.nodes[0].box };
+        const VecInt bounced { phy.pos - phy.vel };
+        const int xs[] { phy.pos.x, bounced.x };
+        const int ys[] { phy.pos.y, bounced.y };
+
+        constexpr auto max { std::numeric_limits<unsigned>::max() };
+        BoundingBox_t merged { max, 0, max, 0 };
+        bool any { false };
+        for (const auto x : xs) {
+            for (const auto y : ys) {
+                const BoundingBox_t bx { box.xLeft  + x, box.xRight + x,
+                                         box.yUp    + y, box.yDown  + y };
+                // A box that wraps around the coordinates only meets the
+                // boxes the broadphase pairs with everything, unless its gap
+                // is narrow
+                if (bx.xLeft > bx.xRight || bx.yUp > bx.yDown) {
+                    if (!bp.PairsOnlyWithOverflow(bx)) {
+                        return { 0, max, 0, max };
+                    }
+                    continue;
+                }
+                merged = { std::min(merged.xLeft,  bx.xLeft),
+                           std::max(merged.xRight, bx.xRight),
+                           std::min(merged.yUp,    bx.yUp),
+                           std::max(merged.yDown,  bx.yDown) };
+                any = true;
+            }
+        }
+        return any ? merged : Transform2WorldCoordinates(box, phy);
+    }
 
-        if (collided) {
-            if (!bn1.root.empty()) {
-                for (auto& bx : bn1.root) {
-                    CheckBoundingBoxNodeCollision(bx, bn2, ph1, ph2);
+    // The colliders asleep don't move, they are checked like the static
+    // ones. The brute force loop goes through them as through any other, the
+    // broadphases only visit the awake ones and find the asleep ones in
+    // trees that are kept from frame to frame, see SyncAsleep. An asleep
+    // collider keeps its collided flags until it is woken
+    template<class EntMan>
+    void Update(EntMan&& ent_man)
+    {
+        ECS_PROFILE_SCOPE("ColliderSystem_t");
+        ECS_ALLOC_SCOPE("ColliderSystem_t");
+        ECS_PERF_SCOPE("ColliderSystem_t",
+                       ent_man.template CountRows<ColliderComponent_t>());
+        m_PrevAwake.swap(m_Handles);
+        m_Colliders.clear();
+        m_Handles.clear();
+        m_Static.clear();
+        m_Dynamic.clear();
+        m_FoundWoken = 0;
+        Reserve(ent_man.template CountRows<ColliderComponent_t>(),
+                ent_man.GetEntities().size());
+        auto gather {
+            [this](ColliderComponent_t& col, auto&& phy, auto& e) {
+                if (!col.BoxTree.IsBuilt()) {
+                    col.BoxTree.Build(col.BoxRoot);
                 }
-            } else if (!bn2.root.empty()) {
-                for (auto& bx : bn2.root) {
-                    CheckBoundingBoxNodeCollision(bn1, bx, ph1, ph2);
+                if (e.IsAwake()) {
+                    DropAsleep(e.GetHandle());
+                    col.BoxTree.ResetCollided();
                 }
-            } else {
-                bn1.collided = bn2.collided = true;
-            }   
+                const auto index
+                {
+                    static_cast<std::uint32_t>(m_Colliders.size())
+                };
+                const bool fixed { col.is_static || !e.IsAwake() };
+                (fixed ? m_Static : m_Dynamic).push_back(index);
+                m_Colliders.push_back({ &col, { phy.pos, phy.vel } });
+                m_Handles.push_back(e.GetHandle());
+            }
+        };
+        if (broadphase == Broadphase_t::BruteForce) {
+            ent_man.template DoForEachAsleep<SystemSignature_t>(gather);
+            m_AsleepSynced = false;
         }
+        m_AsleepGathered = m_Colliders.size();
+        ent_man.template DoForEachAwake<SystemSignature_t>(gather);
+
+        ++m_Frame;
+        m_Contacts.Clear();
+        m_AsleepTouched.clear();
+        m_Touched.assign(m_Colliders.size(), false);
+        switch (broadphase) {
+            case Broadphase_t::Grid:          UpdatePairs(ent_man, m_Grid); break;
+            case Broadphase_t::SweepAndPrune: UpdatePairs(ent_man, m_SAP);  break;
+            default:                          UpdateBruteForce();           break;
+        }
+
+        // The asleep colliders go first and in the order of their rows, as
+        // the brute force loop finds them. The wakes follow this order, so
+        // the rows end up the same whatever the broadphase
+        if constexpr (std::decay_t<EntMan>::IsSparseSet) {
+            auto row {
+                [&ent_man](ECS::EntityHandle_t handle) {
+                    return ent_man.template GetRow<ColliderComponent_t>(
+                                ent_man.GetEntityByID(handle.index));
+                }
+            };
+            std::sort(m_AsleepTouched.begin(), m_AsleepTouched.end(),
+                      [&row](const auto& h1, const auto& h2) {
+                          return row(h1) < row(h2);
+                      });
+        }
+        m_Contacts.touched.insert(m_Contacts.touched.end(),
+                                  m_AsleepTouched.begin(),
+                                  m_AsleepTouched.end());
+        for (std::size_t i { 0 }; i < m_Touched.size(); ++i) {
+            if (m_Touched[i]) {
+                m_Contacts.touched.push_back(m_Handles[i]);
+            }
+        }
+    }
+
+    // Written by Update, valid until the next one
+    auto GetContacts() const -> const ContactBuffer_t&
+    {
+        return m_Contacts;
     }
 
-    void ResetCollidedFlag(BoundingBoxNode_t& bn) const
+    unsigned width  {  };
+    unsigned height {  };
+    Broadphase_t broadphase { Broadphase_t::Grid };
+    ECS::SimdLevel_t simd { ECS::GetSimdLevel() };
+
+    // The narrowphase runs on the pool in batches of about pair_grain pairs
+    ECS::ThreadPool_t* pool { &ECS::ThreadPool_t::GetDefault() };
+    std::size_t pair_grain { 256 };
+
+private:
+    // Room for n colliders in every array that grows with them and for a
+    // contact each, so once the colliders stop growing a frame only
+    // allocates when it has more contacts or pairs than any before
+    void Reserve(std::size_t n, std::size_t n_slots)
     {
-        bn.collided = false;
-        for (auto& bx : bn.root) {
-            ResetCollidedFlag(bx);
+        ECS::ReserveAtLeast(m_Colliders, n);
+        ECS::ReserveAtLeast(m_Handles, n);
+        ECS::ReserveAtLeast(m_PrevAwake, n);
+        ECS::ReserveAtLeast(m_PairInfo, n);
+        ECS::ReserveAtLeast(m_Touched, n);
+        ECS::ReserveAtLeast(m_Contacts.contacts, n);
+        ECS::ReserveAtLeast(m_Contacts.touched, n);
+        ECS::ReserveAtLeast(m_ContactKeys, n);
+        ECS::ReserveAtLeast(m_SortedContacts, n);
+        ECS::ReserveAtLeast(m_Static, n);
+        ECS::ReserveAtLeast(m_Dynamic, n);
+        ECS::ReserveAtLeast(m_Boxes, n);
+        switch (broadphase) {
+            case Broadphase_t::Grid:          m_Grid.Reserve(n); break;
+            case Broadphase_t::SweepAndPrune: m_SAP.Reserve(n);  break;
+            default:                          return;
         }
+        m_StaticTree.Reserve(n);
+        ECS::ReserveAtLeast(m_StaticHandles, n);
+        ECS::ReserveAtLeast(m_StaticBoxes, n);
+        m_AsleepTree.Reserve(n);
+        m_PendingTree.Reserve(n);
+        ECS::ReserveAtLeast(m_Asleep, n);
+        ECS::ReserveAtLeast(m_AsleepEntry, n_slots);
+        ECS::ReserveAtLeast(m_AsleepBoxes, n);
+        ECS::ReserveAtLeast(m_AsleepStamp, n);
+        ECS::ReserveAtLeast(m_AsleepTouched, n);
     }
 
-    template<class EntMan>
-    void Update(EntMan&& ent_man) const
+    // The narrowphase without writing to the trees, only the stacks of the
+    // batch change
+    template<class OnContact_t>
+    void FindContacts(const BoundingBoxTree_t& bt1,
+                      const BoundingBoxTree_t& bt2,
+                      const PhysicsRef_t<VecInt>& ph1,
+                      const PhysicsRef_t<VecInt>& ph2,
+                      NarrowphaseBatch_t& batch,
+                      OnContact_t&& on_contact) const
+    {
+        if (UseMaskDescent(bt1, bt2)) {
+            FindContactsMask(bt1, bt2, ph1, ph2, batch, on_contact);
+        } else {
+            FindContactsWalk(bt1, bt2, ph1, ph2, on_contact);
+        }
+    }
+
+    // Same walk as descending the nested trees: the nodes of the first tree
+    // are checked against the root of the second one until a leaf is hit,
+    // then that leaf is checked against the second tree. A node that misses
+    // skips its subtree
+    template<class OnContact_t>
+    void FindContactsWalk(const BoundingBoxTree_t& bt1,
+                          const BoundingBoxTree_t& bt2,
+                          const PhysicsRef_t<VecInt>& ph1,
+                          const PhysicsRef_t<VecInt>& ph2,
+                          OnContact_t&& on_contact) const
+    {
+        const auto n1   { static_cast<std::uint32_t>(bt1.nodes.size()) };
+        const auto n2   { static_cast<std::uint32_t>(bt2.nodes.size()) };
+        const auto root { Transform2WorldCoordinates(bt2.nodes[0].box, ph2) };
+
+        for (std::uint32_t i { 0 }; i < n1; ) {
+            auto bx1 { Transform2WorldCoordinates(bt1.nodes[i].box, ph1) };
+            if (!CheckBoundingBoxCollision(bx1, root)) {
+                i = bt1.nodes[i].skip;
+                continue;
+            }
+            if (!bt1.IsLeaf(i)) {
+                ++i;
+                continue;
+            }
+
+            for (std::uint32_t j { 0 }; j < n2; ) {
+                auto bx2 { Transform2WorldCoordinates(bt2.nodes[j].box, ph2) };
+                if (!CheckBoundingBoxCollision(bx1, bx2)) {
+                    j = bt2.nodes[j].skip;
+                    continue;
+                }
+                if (bt2.IsLeaf(j)) {
+                    on_contact(i, j);
+                }
+                ++j;
+            }
+            ++i;
+        }
+    }
+
+    // Every node that hits tests all of its children at once and only the
+    // ones set in the mask are visited
+    template<class OnContact_t>
+    void FindContactsMask(const BoundingBoxTree_t& bt1,
+                      const BoundingBoxTree_t& bt2,
+                      const PhysicsRef_t<VecInt>& ph1,
+                      const PhysicsRef_t<VecInt>& ph2,
+                      NarrowphaseBatch_t& batch,
+                      OnContact_t&& on_contact) const
+    {
+        const auto root { Transform2WorldCoordinates(bt2.nodes[0].box, ph2) };
+        if (!CheckBoundingBoxCollision(
+                Transform2WorldCoordinates(bt1.nodes[0].box, ph1), root)) {
+            return;
+        }
+
+        // A node is pushed at most once, the stacks never outgrow the trees
+        if (batch.stack1.size() < bt1.nodes.size()) {
+            batch.stack1.resize(bt1.nodes.size());
+        }
+        if (batch.stack2.size() < bt2.nodes.size()) {
+            batch.stack2.resize(bt2.nodes.size());
+        }
+        auto* const stack1 { batch.stack1.data() };
+        auto* const stack2 { batch.stack2.data() };
+
+        std::size_t top1 { 0 };
+        stack1[top1++] = 0;
+        while (top1) {
+            const auto i { stack1[--top1] };
+            if (!bt1.IsLeaf(i)) {
+                top1 = PushChildHits(bt1, i, root, ph1, stack1, top1);
+                continue;
+            }
+
+            const auto bx1 { Transform2WorldCoordinates(bt1.nodes[i].box, ph1) };
+            std::size_t top2 { 0 };
+            stack2[top2++] = 0;
+            while (top2) {
+                const auto j { stack2[--top2] };
+                if (bt2.IsLeaf(j)) {
+                    on_contact(i, j);
+                    continue;
+                }
+                top2 = PushChildHits(bt2, j, bx1, ph2, stack2, top2);
+            }
+        }
+    }
+
+    // What the pair loops read of a collider, side by side so most pairs
+    // are rejected without touching the components
+    struct PairInfo_t
+    {
+        BoundingBox_t pre    {  };
+        BoundingBox_t post   {  };
+        VecInt        prePos {  };
+        std::uint8_t  mask   {  };
+        bool          leaf   {  };
+        bool          fixed  {  };
+    };
+
+    // The narrowphase of the colliders i1 and i2 into the batch. In the
+    // serial loop i1 has already bounced off the screen and i2 not yet, so
+    // the second one is checked at the position it had before the bounces
+    void CheckPair(std::uint32_t i1, std::uint32_t i2,
+                   NarrowphaseBatch_t& batch) const
+    {
+        const auto& info1 { m_PairInfo[i1] };
+        const auto& info2 { m_PairInfo[i2] };
+        if ((info1.mask & info2.mask) != 0 || (info1.fixed && info2.fixed)
+            || !CheckBoundingBoxCollision(info1.post, info2.pre)) {
+            return;
+        }
+        if (info1.leaf && info2.leaf) {
+            batch.contacts.push_back({ i1, i2, 0, 0 });
+            return;
+        }
+
+        const auto& [col1, phy1] { m_Colliders[i1] };
+        const auto& [col2, phy2] { m_Colliders[i2] };
+        auto pre_pos { info2.prePos };
+        const PhysicsRef_t<VecInt> pre2 { pre_pos, phy2.vel };
+        FindContacts(col1->BoxTree, col2->BoxTree, phy1, pre2, batch,
+            [&batch, i1, i2](std::uint32_t leaf1, std::uint32_t leaf2) {
+                batch.contacts.push_back({ i1, i2, leaf1, leaf2 });
+            });
+    }
+
+    // The bounces only move their own collider, so they all happen before
+    // the narrowphase, which doesn't move anything
+    void BounceAll()
+    {
+        m_PairInfo.clear();
+        for (std::size_t i { 0 }; i < m_Colliders.size(); ++i) {
+            const auto& [col, phy] { m_Colliders[i] };
+            const auto& tree { col->BoxTree };
+            PairInfo_t info {  };
+            info.pre    = Transform2WorldCoordinates(tree.nodes[0].box, phy);
+            info.prePos = phy.pos;
+            info.mask   = col->mask;
+            info.leaf   = tree.IsLeaf(0);
+            info.fixed  = col->is_static || i < m_AsleepGathered;
+            CheckScreenCollision(*col, phy);
+            info.post   = Transform2WorldCoordinates(tree.nodes[0].box, phy);
+            m_PairInfo.push_back(info);
+        }
+    }
+
+    // Runs n_tasks tasks of the narrowphase on the pool and then applies
+    // their contacts in task order
+    template<class Task_t>
+    void RunNarrowphase(std::size_t n_tasks, Task_t&& task)
+    {
+        RunBatches(n_tasks, task);
+        for (std::size_t t { 0 }; t < n_tasks; ++t) {
+            for (const auto& c : m_Batches[t].contacts) {
+                m_Colliders[c.collider1].first->BoxTree.SetCollided(c.leaf1);
+                m_Colliders[c.collider2].first->BoxTree.SetCollided(c.leaf2);
+                m_Touched[c.collider1] = true;
+                m_Touched[c.collider2] = true;
+                PushContactKey(AwakeRank + c.collider1, AwakeRank + c.collider2);
+                m_Contacts.contacts.push_back({ m_Handles[c.collider1],
+                                                m_Handles[c.collider2],
+                                                c.leaf1, c.leaf2 });
+            }
+        }
+    }
+
+    template<class Task_t>
+    void RunBatches(std::size_t n_tasks, Task_t& task)
+    {
+        if (m_Batches.size() < n_tasks) {
+            m_Batches.resize(n_tasks);
+        }
+        auto run {
+            [this, &task](std::size_t t) {
+                ECS_PROFILE_SCOPE("ColliderSystem_t::Narrowphase");
+                ECS_ALLOC_SCOPE("ColliderSystem_t::Narrowphase");
+                ECS_PERF_SCOPE("ColliderSystem_t::Narrowphase", 0);
+                m_Batches[t].contacts.clear();
+                ECS::ReserveAtLeast(m_Batches[t].contacts, pair_grain);
+                task(t, m_Batches[t]);
+            }
+        };
+        if (pool) {
+            pool->ParallelFor(n_tasks, run);
+        } else {
+            for (std::size_t t { 0 }; t < n_tasks; ++t) {
+                run(t);
+            }
+        }
+    }
+
+    // Pushes the children of node i, moved by phy, that overlap box and
+    // returns the new top of the stack
+    auto PushChildHits(const BoundingBoxTree_t& bt, std::uint32_t i,
+                       const BoundingBox_t& box,
+                       const PhysicsRef_t<VecInt>& phy,
+                       std::uint32_t* stack, std::size_t top) const
+    -> std::size_t
     {
-        auto& vec_col
+        using Tree_t = BoundingBoxTree_t;
+        const auto* node { bt.GetSlots(Tree_t::SlotNode) };
+        const auto dx { static_cast<std::uint32_t>(phy.pos.x) };
+        const auto dy { static_cast<std::uint32_t>(phy.pos.y) };
+        const auto end { bt.child_begin[i + 1] };
+        for (auto first { bt.child_begin[i] }; first < end; first += 32) {
+            const AABBArrays_t boxes { bt.GetSlots(Tree_t::SlotXLeft)  + first,
+                                       bt.GetSlots(Tree_t::SlotXRight) + first,
+                                       bt.GetSlots(Tree_t::SlotYUp)    + first,
+                                       bt.GetSlots(Tree_t::SlotYDown)  + first };
+            const std::size_t n { std::min(end - first, 32u) };
+            for (auto mask { OverlapMask(simd, box, boxes, dx, dy, n) };
+                 mask; mask &= mask - 1) {
+                stack[top++] = node[first + __builtin_ctz(mask)];
+            }
+        }
+        return top;
+    }
+
+    // The static tree is built again only when a static collider is added,
+    // removed or moved, or the broadphase changes its max extent
+    void UpdateStaticTree(std::uint64_t max_extent)
+    {
+        bool changed { m_StaticHandles.size() != m_Static.size()
+                       || m_StaticExtent != max_extent };
+        for (std::size_t k { 0 }; k < m_Static.size() && !changed; ++k) {
+            const auto& box { m_PairInfo[m_Static[k]].pre };
+            const auto& old { m_StaticBoxes[k] };
+            changed = m_StaticHandles[k] != m_Handles[m_Static[k]]
+                   || box.xLeft != old.xLeft || box.xRight != old.xRight
+                   || box.yUp   != old.yUp   || box.yDown  != old.yDown;
+        }
+        if (!changed) {
+            return;
+        }
+
+        m_StaticHandles.clear();
+        m_StaticBoxes.clear();
+        for (const auto i : m_Static) {
+            m_StaticHandles.push_back(m_Handles[i]);
+            m_StaticBoxes.push_back(m_PairInfo[i].pre);
+        }
+        m_StaticExtent = max_extent;
+        m_StaticTree.Build(m_StaticBoxes, max_extent);
+    }
+
+    // The tasks take whole rows of the triangle of pairs, about pair_grain
+    // pairs each. Two static colliders are never checked
+    void UpdateBruteForce()
+    {
+        BounceAll();
+        const auto n { static_cast<std::uint32_t>(m_Colliders.size()) };
+        const auto rows { std::max<std::size_t>(pair_grain / std::max(n, 1u),
+                                                1) };
+        RunNarrowphase((n + rows - 1) / rows,
+            [this, n, rows](std::size_t t, NarrowphaseBatch_t& batch) {
+                const auto begin { static_cast<std::uint32_t>(t * rows) };
+                const auto end   { static_cast<std::uint32_t>(
+                                    std::min<std::size_t>(begin + rows, n)) };
+                for (auto i1 { begin }; i1 < end; ++i1) {
+                    for (auto i2 { i1 + 1 }; i2 < n; ++i2) {
+                        CheckPair(i1, i2, batch);
+                    }
+                }
+            });
+    }
+
+    // Same contacts as the brute force loop and in the same order, see
+    // SortContacts. Only the dynamic colliders go through the broadphase,
+    // the tasks take pair_grain pairs of its list each. Then every dynamic
+    // collider queries the static tree once, the tasks take pair_grain
+    // colliders each
+    template<class EntMan, class Broadphase>
+    void UpdatePairs(EntMan& ent_man, Broadphase& bp)
+    {
+        m_ContactKeys.clear();
+        m_Boxes.clear();
+        for (const auto i : m_Dynamic) {
+            const auto& [col, phy] { m_Colliders[i] };
+            m_Boxes.push_back(BroadphaseBox(*col, phy, bp));
+        }
         {
-            ent_man.template GetRequieredComponentStorage<ColliderComponent_t>()
+            ECS_PROFILE_SCOPE_COUNT("ColliderSystem_t::Broadphase",
+                                    m_Boxes.size());
+            ECS_ALLOC_SCOPE("ColliderSystem_t::Broadphase");
+            bp.Build(m_Boxes);
+        }
+        BounceAll();
+        UpdateStaticTree(bp.GetMaxExtent());
+        SyncAsleep(ent_man, bp.GetMaxExtent());
+
+        const auto& pairs { bp.GetPairs() };
+        const auto grain { std::max<std::size_t>(pair_grain, 1) };
+        RunNarrowphase((pairs.size() + grain - 1) / grain,
+            [this, &pairs, grain](std::size_t t, NarrowphaseBatch_t& batch) {
+                const auto end { std::min((t + 1) * grain, pairs.size()) };
+                for (auto p { t * grain }; p < end; ++p) {
+                    CheckPair(m_Dynamic[pairs[p].first],
+                              m_Dynamic[pairs[p].second], batch);
+                }
+            });
+
+        if (!m_Static.empty()) {
+            RunNarrowphase((m_Dynamic.size() + grain - 1) / grain,
+                [this, grain](std::size_t t, NarrowphaseBatch_t& batch) {
+                    const auto end { std::min((t + 1) * grain,
+                                              m_Dynamic.size()) };
+                    for (auto k { t * grain }; k < end; ++k) {
+                        const auto d { m_Dynamic[k] };
+                        m_StaticTree.Query(m_Boxes[k], batch.query,
+                            [this, d, &batch](std::uint32_t sk) {
+                                const auto s { m_Static[sk] };
+                                s < d ? CheckPair(s, d, batch)
+                                      : CheckPair(d, s, batch);
+                            });
+                    }
+                });
+        }
+        if (!m_Asleep.empty()) {
+            QueryAsleep(ent_man);
+        }
+        SortContacts();
+    }
+
+    // Where the brute force loop puts a contact: by the order it gathers the
+    // first collider, then the second one, then the order of the leaves. It
+    // gathers the asleep colliders first, by their rows, then the awake ones
+    struct ContactKey_t
+    {
+        std::uint64_t collider1 {  };
+        std::uint64_t collider2 {  };
+        std::uint32_t contact   {  };
+    };
+
+    constexpr static inline std::uint64_t AwakeRank
+    {
+        std::uint64_t{ 1 } << 32
+    };
+
+    void PushContactKey(std::uint64_t rank1, std::uint64_t rank2)
+    {
+        m_ContactKeys.push_back({ rank1, rank2, static_cast<std::uint32_t>(
+                                                m_Contacts.contacts.size()) });
+    }
+
+    // The broadphase finds the pairs in the order of their cells or of the
+    // sweep, and the static and asleep pairs come after the dynamic ones
+    void SortContacts()
+    {
+        auto less {
+            [](const ContactKey_t& k1, const ContactKey_t& k2) {
+                return k1.collider1 != k2.collider1
+                       ? k1.collider1 < k2.collider1
+                       : k1.collider2 != k2.collider2
+                         ? k1.collider2 < k2.collider2
+                         : k1.contact < k2.contact;
+            }
         };
+        if (std::is_sorted(m_ContactKeys.begin(), m_ContactKeys.end(), less)) {
+            return;
+        }
+        std::sort(m_ContactKeys.begin(), m_ContactKeys.end(), less);
+        m_SortedContacts.clear();
+        for (const auto& key : m_ContactKeys) {
+            m_SortedContacts.push_back(m_Contacts.contacts[key.contact]);
+        }
+        m_Contacts.contacts.swap(m_SortedContacts);
+    }
 
-        for (auto& col : vec_col) { ResetCollidedFlag(col.Self.BoxRoot); }
+    // What the pair loops need of an asleep collider, it doesn't change
+    // while it is asleep. The entry is dropped when the collider wakes
+    struct AsleepCollider_t
+    {
+        ECS::EntityHandle_t handle {  };
+        VecInt              pos    {  };
+        BoundingBox_t       box    {  };
+        std::uint8_t        mask   {  };
+        bool                leaf   {  };
+        bool                valid  {  };
+    };
 
-        for (auto ite1 { vec_col.begin() }; ite1 != vec_col.end(); ++ite1) {
-            auto& ent1 { ent_man.GetEntityByComponent(*ite1) };
-            auto& phy1
+    constexpr static inline std::uint32_t NoEntry { ~std::uint32_t{ 0 } };
+
+    void PushAsleep(ColliderComponent_t& col,
+                    const PhysicsRef_t<VecInt>& phy,
+                    ECS::EntityHandle_t handle)
+    {
+        if (!col.BoxTree.IsBuilt()) {
+            col.BoxTree.Build(col.BoxRoot);
+        }
+        const auto& tree  { col.BoxTree };
+        const auto  index { static_cast<std::size_t>(handle.index) };
+        if (index >= m_AsleepEntry.size()) {
+            m_AsleepEntry.resize(index + 1, NoEntry);
+        }
+        m_AsleepEntry[index] = static_cast<std::uint32_t>(m_Asleep.size());
+        m_Asleep.push_back({ handle, phy.pos,
+                             Transform2WorldCoordinates(tree.nodes[0].box,
+                                                        phy),
+                             col.mask, tree.IsLeaf(0), true });
+    }
+
+    // Called for every awake collider, the ones that had an entry were
+    // woken since the last frame
+    void DropAsleep(ECS::EntityHandle_t handle)
+    {
+        const auto index { static_cast<std::size_t>(handle.index) };
+        if (index >= m_AsleepEntry.size() || m_AsleepEntry[index] == NoEntry) {
+            return;
+        }
+        auto& entry { m_Asleep[m_AsleepEntry[index]] };
+        entry.valid = false;
+        m_AsleepEntry[index] = NoEntry;
+        ++m_AsleepDropped;
+        if (entry.handle == handle) {
+            ++m_FoundWoken;
+        }
+    }
+
+    // The colliders that fell asleep are the ones that were awake the last
+    // frame and aren't now, they are added to the small tree of the pending
+    // ones. The woken ones were dropped by the gather. When the rows that
+    // entered and left the asleep ones of the pool don't add up to that,
+    // something else changed them and all the entries are gathered again.
+    // The big tree is built again when a quarter of its entries are dropped
+    // or the pending ones are a quarter of it
+    template<class EntMan>
+    void SyncAsleep(EntMan& ent_man, std::uint64_t max_extent)
+    {
+        std::uint64_t found_slept { 0 };
+        for (const auto handle : m_PrevAwake) {
+            auto e { ent_man.GetEntityByHandle(handle) };
+            if (!e || e->get().IsAwake()
+                || !ent_man.template HasComponents<ColliderComponent_t,
+                                                   PhysicsComponent_t>
+                                                   (e->get())) {
+                continue;
+            }
+            auto&& phy
             {
-                ent_man.template GetRequieredComponent<PhysicsComponent_t>(ent1)
+                ent_man.template GetRequieredComponent<PhysicsComponent_t>
+                (e->get())
             };
-            auto& col1 { ite1->Self };
-            CheckScreenCollision(col1, phy1);
-            for (auto ite2 { std::next(ite1) }; ite2 != vec_col.end(); ++ite2) {
-                auto& ent2 { ent_man.GetEntityByComponent(*ite2) };
-                auto& phy2
+            PushAsleep(ent_man.template
+                       GetRequieredComponent<ColliderComponent_t>(e->get()),
+                       { phy.pos, phy.vel }, handle);
+            ++found_slept;
+        }
+
+        const auto [slept, woken]
+        {
+            ent_man.template GetAsleepChanges<ColliderComponent_t>()
+        };
+        const bool in_sync { m_AsleepSynced
+                             && m_AsleepExtent == max_extent
+                             && slept - m_SleptRows == found_slept
+                             && woken - m_WokenRows == m_FoundWoken };
+        m_AsleepSynced = true;
+        m_AsleepExtent = max_extent;
+        m_SleptRows    = slept;
+        m_WokenRows    = woken;
+
+        if (!in_sync) {
+            for (const auto& entry : m_Asleep) {
+                if (entry.valid) {
+                    m_AsleepEntry[entry.handle.index] = NoEntry;
+                }
+            }
+            m_Asleep.clear();
+            ent_man.template DoForEachAsleep<SystemSignature_t>(
+                    [this](ColliderComponent_t& col, auto&& phy, auto& e) {
+                        PushAsleep(col, { phy.pos, phy.vel }, e.GetHandle());
+                    });
+            BuildAsleepTrees();
+        } else if (4 * m_AsleepDropped > m_AsleepTreeEnd
+                   || 4 * (m_Asleep.size() - m_AsleepTreeEnd)
+                      > m_AsleepTreeEnd) {
+            BuildAsleepTrees();
+        } else if (found_slept) {
+            BuildPendingTree();
+        }
+        m_AsleepStamp.resize(m_Asleep.size(), 0);
+    }
+
+    // Drops the entries of the woken colliders and puts all the rest in the
+    // big tree
+    void BuildAsleepTrees()
+    {
+        std::size_t kept { 0 };
+        for (std::size_t k { 0 }; k < m_Asleep.size(); ++k) {
+            if (!m_Asleep[k].valid) {
+                continue;
+            }
+            m_AsleepEntry[m_Asleep[k].handle.index] =
+                static_cast<std::uint32_t>(kept);
+            m_Asleep[kept++] = m_Asleep[k];
+        }
+        m_Asleep.resize(kept);
+        m_AsleepStamp.assign(kept, 0);
+        m_AsleepDropped = 0;
+        m_AsleepTreeEnd = kept;
+
+        m_AsleepBoxes.clear();
+        for (const auto& entry : m_Asleep) {
+            m_AsleepBoxes.push_back(entry.box);
+        }
+        m_AsleepTree.Build(m_AsleepBoxes, m_AsleepExtent);
+        BuildPendingTree();
+    }
+
+    void BuildPendingTree()
+    {
+        m_AsleepBoxes.clear();
+        for (auto k { m_AsleepTreeEnd }; k < m_Asleep.size(); ++k) {
+            m_AsleepBoxes.push_back(m_Asleep[k].box);
+        }
+        m_PendingTree.Build(m_AsleepBoxes, m_AsleepExtent);
+    }
+
+    // The same check as CheckPair(s, d) in the brute force loop, where the
+    // asleep rows come first. The tree of s is only looked up for the
+    // narrowphase, the lookups don't write so the tasks can share them
+    template<class EntMan>
+    void CheckAsleepPair(const EntMan& ent_man,
+                         std::uint32_t s, std::uint32_t d,
+                         NarrowphaseBatch_t& batch) const
+    {
+        const auto& asleep { m_Asleep[s] };
+        const auto& info   { m_PairInfo[d] };
+        if (!asleep.valid || (asleep.mask & info.mask) != 0
+            || !CheckBoundingBoxCollision(asleep.box, info.pre)) {
+            return;
+        }
+        if (asleep.leaf && info.leaf) {
+            batch.contacts.push_back({ s, d, 0, 0 });
+            return;
+        }
+
+        const auto& col
+        {
+            ent_man.template GetRequieredComponent<ColliderComponent_t>(
+                        ent_man.GetEntityByID(asleep.handle.index))
+        };
+        auto pos { asleep.pos };
+        VecInt vel {  };
+        const PhysicsRef_t<VecInt> phy { pos, vel };
+        const auto& [col2, phy2] { m_Colliders[d] };
+        auto pre_pos { info.prePos };
+        const PhysicsRef_t<VecInt> pre2 { pre_pos, phy2.vel };
+        FindContacts(col.BoxTree, col2->BoxTree, phy, pre2, batch,
+            [&batch, s, d](std::uint32_t leaf1, std::uint32_t leaf2) {
+                batch.contacts.push_back({ s, d, leaf1, leaf2 });
+            });
+    }
+
+    // Every dynamic collider queries both trees of the asleep ones, the
+    // contacts have the entry of m_Asleep as first collider
+    template<class EntMan>
+    void QueryAsleep(EntMan& ent_man)
+    {
+        const auto grain { std::max<std::size_t>(pair_grain, 1) };
+        const auto n_tasks { (m_Dynamic.size() + grain - 1) / grain };
+        auto task {
+            [this, grain, &ent_man](std::size_t t, NarrowphaseBatch_t& batch) {
+                const auto& man { std::as_const(ent_man) };
+                const auto pending
                 {
-                    ent_man.template
-                    GetRequieredComponent<PhysicsComponent_t>(ent2)
+                    static_cast<std::uint32_t>(m_AsleepTreeEnd)
                 };
-                auto& col2 { ite2->Self };
-                if ((col1.mask & col2.mask) == 0) {
-                    CheckBoundingBoxNodeCollision(col1.BoxRoot, col2.BoxRoot,
-                                                  phy1, phy2);
+                const auto end { std::min((t + 1) * grain, m_Dynamic.size()) };
+                for (auto k { t * grain }; k < end; ++k) {
+                    const auto d { m_Dynamic[k] };
+                    m_AsleepTree.Query(m_Boxes[k], batch.query,
+                        [this, d, &batch, &man](std::uint32_t s) {
+                            CheckAsleepPair(man, s, d, batch);
+                        });
+                    m_PendingTree.Query(m_Boxes[k], batch.query,
+                        [this, d, &batch, &man, pending](std::uint32_t s) {
+                            CheckAsleepPair(man, pending + s, d, batch);
+                        });
                 }
             }
+        };
+        RunBatches(n_tasks, task);
+
+        for (std::size_t t { 0 }; t < n_tasks; ++t) {
+            for (const auto& c : m_Batches[t].contacts) {
+                const auto& asleep { m_Asleep[c.collider1] };
+                auto& ent { ent_man.GetEntityByID(asleep.handle.index) };
+                auto& col
+                {
+                    ent_man.template GetRequieredComponent<ColliderComponent_t>(
+                                ent)
+                };
+                col.BoxTree.SetCollided(c.leaf1);
+                m_Colliders[c.collider2].first->BoxTree.SetCollided(c.leaf2);
+                m_Touched[c.collider2] = true;
+                if (m_AsleepStamp[c.collider1] != m_Frame) {
+                    m_AsleepStamp[c.collider1] = m_Frame;
+                    m_AsleepTouched.push_back(asleep.handle);
+                }
+                PushContactKey(AsleepRank(ent_man, ent),
+                               AwakeRank + c.collider2);
+                m_Contacts.contacts.push_back({ asleep.handle,
+                                                m_Handles[c.collider2],
+                                                c.leaf1, c.leaf2 });
+            }
         }
     }
 
-    unsigned width  {  };
-    unsigned height {  };
+    // Only the sparse sets keep colliders asleep
+    template<class EntMan, class Entity>
+    static auto AsleepRank(EntMan& ent_man, const Entity& ent) -> std::uint64_t
+    {
+        if constexpr (std::decay_t<EntMan>::IsSparseSet) {
+            return ent_man.template GetRow<ColliderComponent_t>(ent);
+        } else {
+            return 0;
+        }
+    }
+
+    // Filled from the storage every frame so the pair loop doesn't depend on
+    // how the manager lays out the components
+    std::vector<std::pair<ColliderComponent_t*,
+                          PhysicsRef_t<VecInt>>> m_Colliders {  };
+    std::vector<ECS::EntityHandle_t> m_Handles  {  };
+    std::vector<PairInfo_t>          m_PairInfo {  };
+    std::vector<bool>                m_Touched  {  };
+    ContactBuffer_t                  m_Contacts {  };
+    std::vector<std::uint32_t>       m_Static   {  };
+    std::vector<std::uint32_t>       m_Dynamic  {  };
+    std::vector<BoundingBox_t>       m_Boxes    {  };
+    SpatialHashGrid_t                m_Grid     {  };
+    SweepAndPrune_t                  m_SAP      {  };
+    std::vector<NarrowphaseBatch_t>  m_Batches  {  };
+
+    // The contacts of the broadphases in the order of the brute force loop
+    std::vector<ContactKey_t>        m_ContactKeys    {  };
+    std::vector<Contact_t>           m_SortedContacts {  };
+
+    // The static colliders the tree was built with, in the order of
+    // m_Static, to know when it has to be built again
+    StaticAABBTree_t                 m_StaticTree    {  };
+    std::vector<ECS::EntityHandle_t> m_StaticHandles {  };
+    std::vector<BoundingBox_t>       m_StaticBoxes   {  };
+    std::uint64_t                    m_StaticExtent  {  };
+
+    // The colliders [0, m_AsleepGathered) of m_Colliders are asleep, only
+    // the brute force loop gathers them
+    std::size_t                      m_AsleepGathered {  };
+    std::uint32_t                    m_Frame          {  };
+
+    // The entries [0, m_AsleepTreeEnd) of m_Asleep are in the big tree and
+    // the rest in the pending one. m_AsleepEntry has the entry of each
+    // entity slot and the stamp is the last frame each entry was touched
+    StaticAABBTree_t                 m_AsleepTree    {  };
+    StaticAABBTree_t                 m_PendingTree   {  };
+    std::vector<AsleepCollider_t>    m_Asleep        {  };
+    std::vector<std::uint32_t>       m_AsleepEntry   {  };
+    std::vector<BoundingBox_t>       m_AsleepBoxes   {  };
+    std::vector<std::uint32_t>       m_AsleepStamp   {  };
+    std::vector<ECS::EntityHandle_t> m_AsleepTouched {  };
+    std::vector<ECS::EntityHandle_t> m_PrevAwake     {  };
+    std::size_t                      m_AsleepTreeEnd {  };
+    std::size_t                      m_AsleepDropped {  };
+    std::uint64_t                    m_FoundWoken    {  };
+    std::uint64_t                    m_SleptRows     {  };
+    std::uint64_t                    m_WokenRows     {  };
+    std::uint64_t                    m_AsleepExtent  {  };
+    bool                             m_AsleepSynced  { false };
 };
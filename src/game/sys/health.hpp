@@ -2,49 +2,60 @@
 
 #include "sys.hpp"
 
+#include <ecs/man/command_buffer.hpp>
+
 #include <game/cmp/health.hpp>
-#include <game/cmp/collider.hpp>
+#include <game/util/contacts.hpp>
 #include <iostream>
-struct HealthSystem_t : SystemBase_t<HealthComponent_t,
-                                     ColliderComponent_t>
+
+// Only the entities in the contacts of the collider system lose health, the
+// rest of the pool isn't visited
+struct HealthSystem_t : SystemBase_t<HealthComponent_t>
 {
-    bool LeafNodeCollided(const BoundingBoxNode_t& bxn)
-    {
-        if (bxn.root.empty()) {
-            return bxn.collided;
-        } else {
-            for (auto& bn : bxn.root) {
-                if (LeafNodeCollided(bn)) {
-                    return true;
-                }
-            }
-        }
-        return false;
-    }
+    using SystemResources_t = TMP::TypeList_t<ConsoleResource_t,
+                                              const ContactResource_t>;
+
+    explicit HealthSystem_t(const ContactBuffer_t& contacts)
+        : m_Contacts { contacts } {  }
 
     template<class EntMan>
     constexpr void
     Update(EntMan&& ent_man)
     {
-        ent_man.template DoForEachComponentType<SystemSignature_t>(
-                [this, &ent_man](HealthComponent_t& hel,
-                   ColliderComponent_t& col,
-                   auto& e){
-                    if (hel.health && LeafNodeCollided(col.BoxRoot)) {
-                        if (--hel.health == 0) {
-                            ent_man.RemoveEntity(e);
-                            std::cout << "Entity: "
-                                      << e.GetEntityID()
-                                      << " is dead!"
-                                      << std::endl;
-                        } else {
-                            std::cout << "Entity "
-                                      << e.GetEntityID()
-                                      << "[HEALTH]: "
-                                      << hel.health
-                                      << std::endl;
-                            }
-                    }
-                });
+        ECS_PROFILE_SCOPE_COUNT("HealthSystem_t", m_Contacts.touched.size());
+        ECS_ALLOC_SCOPE("HealthSystem_t");
+        ECS_PERF_SCOPE("HealthSystem_t", m_Contacts.touched.size());
+        for (const auto handle : m_Contacts.touched) {
+            auto e { ent_man.GetEntityByHandle(handle) };
+            if (!e) {
+                continue;
+            }
+            auto hel_opt
+            {
+                ent_man.template
+                GetOptionalComponent<HealthComponent_t>(e->get())
+            };
+            if (!hel_opt) {
+                continue;
+            }
+
+            auto& hel { hel_opt->get() };
+            if (hel.health) {
+                if (--hel.health == 0) {
+                    std::cout << "Entity: "
+                              << handle.index
+                              << " is dead!\n";
+                    ent_man.GetCommandBuffer().RemoveEntity(handle);
+                } else {
+                    std::cout << "Entity "
+                              << handle.index
+                              << "[HEALTH]: "
+                              << hel.health << '\n';
+                }
+            }
+        }
     }
+
+private:
+    const ContactBuffer_t& m_Contacts;
 };
@@ -1,26 +1,43 @@
 #pragma once
 
-#include "raylib.h"
 #include "sys.hpp"
 
+#include <ecs/man/command_buffer.hpp>
+
 #include <game/cmp/input.hpp>
 #include <game/cmp/physics.hpp>
 
-struct InputSystem_t : SystemBase_t<InputComponent_t, PhysicsComponent_t>
+// The keys are asked to the platform backend, see game/platform
+template<class Platform_t>
+struct InputSystem_t : SystemBase_t<const InputComponent_t, PhysicsComponent_t>
 {
+    explicit InputSystem_t(const Platform_t& platform)
+        : m_Platform { platform } {  }
+
     template<class EntMan>
     void Update(EntMan&& ent_man)
     {
-        ent_man.template DoForEachComponentType<SystemSignature_t>(
-                [](const InputComponent_t& inp,
-                   PhysicsComponent_t& phy,
-                   auto&){
-                    phy.vel *= 0;
-                    if (IsKeyDown(inp.k_down)) phy.vel.y = +5;
-                    if (IsKeyDown(inp.k_up))   phy.vel.y = -5;
-                    if (IsKeyDown(inp.k_left)) phy.vel.x = -5;
-                    if (IsKeyDown(inp.k_right))phy.vel.x = +5;
-                });
+        ECS_PROFILE_SCOPE("InputSystem_t");
+        ECS_ALLOC_SCOPE("InputSystem_t");
+        ECS_PERF_SCOPE("InputSystem_t",
+                       ent_man.template CountRows<InputComponent_t>());
+        // The view walks the input pool, not every physics body
+        for (auto [inp, phy, e] :
+             ent_man.template View<InputComponent_t, PhysicsComponent_t>()) {
+            phy.vel *= 0;
+            if (m_Platform.IsKeyDown(inp.k_down)) phy.vel.y = +5;
+            if (m_Platform.IsKeyDown(inp.k_up))   phy.vel.y = -5;
+            if (m_Platform.IsKeyDown(inp.k_left)) phy.vel.x = -5;
+            if (m_Platform.IsKeyDown(inp.k_right))phy.vel.x = +5;
+            // The sleep system skips these bodies, one put to sleep by hand
+            // is woken at the next flush once it gets a velocity
+            if (!e.IsAwake() && (phy.vel.x != 0 || phy.vel.y != 0)) {
+                ent_man.GetCommandBuffer().Wake(e.GetHandle());
+            }
+        }
     }
+
+private:
+    const Platform_t& m_Platform;
 };
 
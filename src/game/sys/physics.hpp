@@ -2,6 +2,10 @@
 
 #include "sys.hpp"
 
+#include <cstdint>
+#include <type_traits>
+
+#include <ecs/util/simd.hpp>
 #include <game/cmp/physics.hpp>
 
 struct PhysicsSystem_t : SystemBase_t<PhysicsComponent_t>
@@ -9,11 +13,40 @@ struct PhysicsSystem_t : SystemBase_t<PhysicsComponent_t>
     template<class EntMan_t>
     void Update(EntMan_t&& ent_man)
     {
-        ent_man.template DoForEachComponentType<SystemSignature_t>(
-                [](PhysicsComponent_t& phy,
-                   auto&) {
-                    phy.pos += phy.vel;
-                });
+        ECS_PROFILE_SCOPE("PhysicsSystem_t");
+        ECS_ALLOC_SCOPE("PhysicsSystem_t");
+        ECS_PERF_SCOPE("PhysicsSystem_t",
+                       ent_man.template CountRows<PhysicsComponent_t>());
+        using Man_t = std::remove_reference_t<EntMan_t>;
+
+        // With pos and vel in their own arrays the integration is a packed
+        // add of the two arrays, whole chunks at a time. The bodies asleep
+        // don't move, only the awake rows are added
+        if constexpr (Man_t::template IsSplit<PhysicsComponent_t>) {
+            ent_man.template ParallelForEachAwakeBatch<PhysicsComponent_t>(
+                    [](auto& phys, std::size_t begin, std::size_t end) {
+                        Integrate(phys.template GetField<0>().data() + begin,
+                                  phys.template GetField<1>().data() + begin,
+                                  end - begin);
+                    });
+        } else {
+            ent_man.template ParallelForEach<SystemSignature_t>(
+                    [](auto&& phy,
+                       auto&) {
+                        phy.pos += phy.vel;
+                    });
+        }
     }
-};
 
+    // pos[i] += vel[i], the vectors are seen as 2 * n packed ints
+    static void Integrate(VecInt* pos, const VecInt* vel, std::size_t n)
+    {
+        static_assert(sizeof(VecInt) == 2 * sizeof(std::int32_t)
+                      && std::is_standard_layout_v<VecInt>,
+                      "The kernel adds the coordinates as packed ints");
+
+        ECS::AddInPlace(reinterpret_cast<std::int32_t*>(pos),
+                        reinterpret_cast<const std::int32_t*>(vel),
+                        2 * n);
+    }
+};
@@ -6,99 +6,107 @@
 #include <game/cmp/physics.hpp>
 #include <game/cmp/collider.hpp>
 
-#include <raylib.h>
-
+// Draws through the platform backend, see game/platform. The window is open
+// while the system lives
+template<class Platform_t>
 class RenderSystem_t : SystemBase_t<RenderComponent_t,
                                     PhysicsComponent_t>
 {
 public:
-    RenderSystem_t(unsigned wh, unsigned hg, const char* name)
+    RenderSystem_t(Platform_t& platform,
+                   unsigned wh, unsigned hg, const char* name)
+        : m_Platform { platform }
     {
-        InitWindow(wh, hg, name);
-        SetTargetFPS(60);
+        m_Platform.OpenWindow(wh, hg, name);
     }
 
     ~RenderSystem_t()
     {
-        CloseWindow();
+        m_Platform.CloseWindow();
     }
 
     void DrawOneEntity(const RenderComponent_t& ren,
-                       const PhysicsComponent_t& phy) const
+                       const VecInt& phy_pos) const
     {
-        const Vector2 pos { static_cast<float>(phy.pos.x),
-                            static_cast<float>(phy.pos.y) };
-
-        const float wh { static_cast<float>(ren.sprite.get().width) };
-        const float hg { static_cast<float>(ren.sprite.get().height) };
-        const Rectangle rec_src  { 0, 0, wh, hg };
-        const Rectangle rec_dest { pos.x, pos.y, ren.wh.x, ren.wh.y };
-        const Vector2 ori_vec { 0, 0 };
-        DrawTexturePro(ren.sprite, rec_src, rec_dest,
-                       ori_vec, 0.0f, WHITE);
+        const VecFloat pos { static_cast<float>(phy_pos.x),
+                             static_cast<float>(phy_pos.y) };
+
+        const float wh { static_cast<float>(ren.sprite.width) };
+        const float hg { static_cast<float>(ren.sprite.height) };
+        const Rect_t rec_src  { 0, 0, wh, hg };
+        const Rect_t rec_dest { pos.x, pos.y, ren.wh.x, ren.wh.y };
+        const VecFloat ori_vec { 0, 0 };
+        m_Platform.DrawTexturePro(ren.sprite, rec_src, rec_dest,
+                                  ori_vec, 0.0f, WhiteColor);
     }
 
-    Rectangle
+    Rect_t
     RectangleFromBoundingBox(const BoundingBox_t& box, int x, int y) const
     {
         const auto rx { box.xLeft  + x };
         const auto ry { box.yUp + y };
         const auto wh { box.xRight - box.xLeft };
         const auto hg { box.yDown  - box.yUp };
-        const Rectangle rec { static_cast<float>(rx),
-                              static_cast<float>(ry),
-                              static_cast<float>(wh),
-                              static_cast<float>(hg) };
+        const Rect_t rec { static_cast<float>(rx),
+                           static_cast<float>(ry),
+                           static_cast<float>(wh),
+                           static_cast<float>(hg) };
         return rec;
     }
 
-    void DrawBox(const BoundingBox_t& box, int x, int y, const Color& c) const
+    void DrawBox(const BoundingBox_t& box, int x, int y, Color_t c) const
     {
         auto rec { RectangleFromBoundingBox(box, x, y) };
-        DrawRectangleLinesEx(rec, 2.0f, c);
+        m_Platform.DrawRectangleLines(rec, 2.0f, c);
     }
 
+    // Every level of the tree is drawn with half the color of its parent
     void
-    DrawBoxNode(const BoundingBoxNode_t& b_node,
-                int x, int y, const Color& c) const
+    DrawBoxTree(const BoundingBoxTree_t& b_tree,
+                int x, int y, Color_t c) const
     {
-        if (b_node.collided) {
-            auto rec{ RectangleFromBoundingBox(b_node.box, x, y) };
-            DrawRectangle(rec.x, rec.y, rec.width, rec.height, c);    
-        }
-        DrawBox(b_node.box, x, y, c);
-        for (auto& box : b_node.root) {
-            DrawBoxNode(box, x, y, GetColor(ColorToInt(c) >> 1));
+        for (std::uint32_t i { 0 }; i < b_tree.nodes.size(); ++i) {
+            const auto& node { b_tree.nodes[i] };
+            const auto  color { Color_t::FromInt(c.ToInt() >> node.depth) };
+            if (b_tree.IsCollided(i)) {
+                auto rec{ RectangleFromBoundingBox(node.box, x, y) };
+                m_Platform.DrawRectangle(rec, color);
+            }
+            DrawBox(node.box, x, y, color);
         }
     }
 
     template<class EntMan>
     bool Update(EntMan&& ent_man) const
     {
-        BeginDrawing();
-        ClearBackground(WHITE);
-        DrawFPS(10, 10);
+        ECS_PROFILE_SCOPE("RenderSystem_t");
+        ECS_ALLOC_SCOPE("RenderSystem_t");
+        ECS_PERF_SCOPE("RenderSystem_t",
+                       ent_man.template CountRows<RenderComponent_t>());
+        m_Platform.BeginDrawing();
+        m_Platform.ClearBackground(WhiteColor);
+        m_Platform.DrawFPS(10, 10);
         ent_man.template DoForEachComponentType<SystemSignature_t>(
                 [&](const RenderComponent_t& ren,
-                    const PhysicsComponent_t& phy,
+                    const auto& phy,
                     auto& ent){
 
-                    DrawOneEntity(ren, phy);
+                    DrawOneEntity(ren, phy.pos);
                     if (m_DebugFlag) {
                         auto& col
                         {
                             ent_man.template
                             GetRequieredComponent<ColliderComponent_t>(ent)
                         };
-                        DrawBoxNode(col.BoxRoot,
+                        DrawBoxTree(col.BoxTree,
                                     phy.pos.x, phy.pos.y, m_DebugColor);
 
                         
                     }
                 });
-        EndDrawing();
+        m_Platform.EndDrawing();
 
-        return !WindowShouldClose();
+        return !m_Platform.ShouldClose();
     }
 
     constexpr auto
@@ -109,6 +117,7 @@ public:
     }
 
 private:
-    mutable bool m_DebugFlag { false };
-    mutable Color m_DebugColor { RED };
+    Platform_t&     m_Platform;
+    mutable bool    m_DebugFlag  { false };
+    mutable Color_t m_DebugColor { RedColor };
 };
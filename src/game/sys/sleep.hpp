@@ -0,0 +1,107 @@
+#pragma once
+
+#include "sys.hpp"
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <ecs/man/command_buffer.hpp>
+
+#include <game/cmp/input.hpp>
+#include <game/cmp/physics.hpp>
+#include <game/util/contacts.hpp>
+
+// Puts to sleep the entities that had no velocity and no contact for
+// frames_to_sleep updates in a row, and wakes the asleep ones that were hit.
+// Only the awake physics rows and the contacts are visited, the changes go
+// to the command buffer and happen at its flush. The bodies with an input
+// component never sleep: the input system writes their velocity every frame
+// and a wake it records would land after the physics skipped the body
+struct SleepSystem_t : SystemBase_t<const PhysicsComponent_t>
+{
+    using SystemResources_t = TMP::TypeList_t<const ContactResource_t>;
+
+    explicit SleepSystem_t(const ContactBuffer_t& contacts,
+                           std::uint32_t frames = 60)
+        : frames_to_sleep { frames }, m_Contacts { contacts } {  }
+
+    template<class EntMan>
+    void Update(EntMan&& ent_man)
+    {
+        ECS_PROFILE_SCOPE("SleepSystem_t");
+        ECS_ALLOC_SCOPE("SleepSystem_t");
+        ECS_PERF_SCOPE("SleepSystem_t",
+                       ent_man.template CountRows<PhysicsComponent_t>());
+        auto& cmds { ent_man.GetCommandBuffer() };
+        ECS::ReserveAtLeast(m_Idle, ent_man.GetEntities().size());
+
+        ++m_Frame;
+        for (const auto handle : m_Contacts.touched) {
+            auto e { ent_man.GetEntityByHandle(handle) };
+            if (!e) {
+                continue;
+            }
+            if (!e->get().IsAwake()) {
+                cmds.Wake(handle);
+            }
+            GetIdle(handle).touched = m_Frame;
+        }
+
+        ent_man.template DoForEachAwake<SystemSignature_t>(
+                [this, &cmds, &ent_man](const auto& phy, auto& e) {
+                    if (IsDriven(ent_man, e)) {
+                        return;
+                    }
+                    auto& idle { GetIdle(e.GetHandle()) };
+                    if (phy.vel.x != 0 || phy.vel.y != 0
+                        || idle.touched == m_Frame) {
+                        idle.frames = 0;
+                        return;
+                    }
+                    if (++idle.frames >= frames_to_sleep) {
+                        idle.frames = 0;
+                        cmds.Sleep(e.GetHandle());
+                    }
+                });
+    }
+
+    std::uint32_t frames_to_sleep { 60 };
+
+private:
+    template<class EntMan, class Entity>
+    static auto IsDriven(const EntMan& ent_man, const Entity& e) -> bool
+    {
+        using Manager_t = std::decay_t<EntMan>;
+        if constexpr (Manager_t::template HasComponentType<InputComponent_t>) {
+            return ent_man.template HasComponents<InputComponent_t>(e);
+        } else {
+            return false;
+        }
+    }
+
+    // Kept for each entity slot, a new entity in the slot starts again
+    struct Idle_t
+    {
+        ECS::EntityGeneration_t generation {  };
+        std::uint32_t           frames     {  };
+        std::uint32_t           touched    {  };
+    };
+
+    auto GetIdle(ECS::EntityHandle_t handle) -> Idle_t&
+    {
+        const auto index { static_cast<std::size_t>(handle.index) };
+        if (index >= m_Idle.size()) {
+            m_Idle.resize(index + 1);
+        }
+        auto& idle { m_Idle[index] };
+        if (idle.generation != handle.generation) {
+            idle = { handle.generation, 0, 0 };
+        }
+        return idle;
+    }
+
+    const ContactBuffer_t& m_Contacts;
+    std::vector<Idle_t>    m_Idle  {  };
+    std::uint32_t          m_Frame {  };
+};
@@ -1,13 +1,22 @@
 #pragma once
 
 #include <tuple>
+#include <ecs/util/alloc_tracker.hpp>
+#include <ecs/util/perf_counters.hpp>
+#include <ecs/util/profiler.hpp>
 #include <tmp/type_list.hpp>
 
+// Resource for the access list of the systems that write to the console
+struct ConsoleResource_t {  };
+
+// A const component of the signature is only read by the system, the
+// resources are what the system touches outside of the entity manager
 template<class MainComponent_t, class... ExtraComponents_t>
 struct SystemBase_t
 {
     virtual ~SystemBase_t() = default;
     using SystemSignature_t = TMP::TypeList_t<MainComponent_t, ExtraComponents_t...>;
+    using SystemResources_t = TMP::TypeList_t<>;
 };
 
 //#include <game/cmp/component.hpp>
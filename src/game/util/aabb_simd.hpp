@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ecs/util/simd.hpp>
+
+#include <game/cmp/collider.hpp>
+
+// Boxes in structure of arrays form, box k is
+// [xLeft[k], xRight[k]] x [yUp[k], yDown[k]]
+struct AABBArrays_t
+{
+    const std::uint32_t* xLeft  {  };
+    const std::uint32_t* xRight {  };
+    const std::uint32_t* yUp    {  };
+    const std::uint32_t* yDown  {  };
+};
+
+// Bit k of the result is set when box overlaps box k of the arrays moved by
+// (dx, dy), for k in [0, n) and n <= 32. The sums wrap around and are
+// compared as unsigned, the same as the scalar test. The wide paths read up
+// to the next multiple of their width, the arrays must be padded for it
+inline auto OverlapMaskScalar(const BoundingBox_t& box,
+                              const AABBArrays_t& boxes,
+                              std::uint32_t dx, std::uint32_t dy,
+                              std::size_t n)
+-> std::uint32_t
+{
+    std::uint32_t mask { 0 };
+    for (std::size_t k { 0 }; k < n; ++k) {
+        const std::uint32_t xl { boxes.xLeft[k]  + dx };
+        const std::uint32_t xr { boxes.xRight[k] + dx };
+        const std::uint32_t yu { boxes.yUp[k]    + dy };
+        const std::uint32_t yd { boxes.yDown[k]  + dy };
+        const bool hit { xl <= box.xRight && box.xLeft <= xr
+                      && yu <= box.yDown  && box.yUp   <= yd };
+        mask |= std::uint32_t{ hit } << k;
+    }
+    return mask;
+}
+
+#ifdef ECS_SIMD_X86
+
+// SSE2 only compares signed lanes, flipping the top bit keeps the unsigned
+// order. A miss is any of the four "greater than"
+__attribute__((target("sse2")))
+inline auto OverlapMaskSSE2(const BoundingBox_t& box,
+                            const AABBArrays_t& boxes,
+                            std::uint32_t dx, std::uint32_t dy,
+                            std::size_t n)
+-> std::uint32_t
+{
+    const auto bias { _mm_set1_epi32(INT32_MIN) };
+    const auto vdx  { _mm_set1_epi32(static_cast<int>(dx)) };
+    const auto vdy  { _mm_set1_epi32(static_cast<int>(dy)) };
+    const auto bxl  { _mm_set1_epi32(static_cast<int>(box.xLeft  ^ 0x80000000u)) };
+    const auto bxr  { _mm_set1_epi32(static_cast<int>(box.xRight ^ 0x80000000u)) };
+    const auto byu  { _mm_set1_epi32(static_cast<int>(box.yUp    ^ 0x80000000u)) };
+    const auto byd  { _mm_set1_epi32(static_cast<int>(box.yDown  ^ 0x80000000u)) };
+
+    std::uint32_t mask { 0 };
+    for (std::size_t k { 0 }; k < n; k += 4) {
+        const auto xl { _mm_xor_si128(_mm_add_epi32(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(boxes.xLeft + k)), vdx), bias) };
+        const auto xr { _mm_xor_si128(_mm_add_epi32(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(boxes.xRight + k)), vdx), bias) };
+        const auto yu { _mm_xor_si128(_mm_add_epi32(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(boxes.yUp + k)), vdy), bias) };
+        const auto yd { _mm_xor_si128(_mm_add_epi32(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(boxes.yDown + k)), vdy), bias) };
+        const auto miss { _mm_or_si128(
+                            _mm_or_si128(_mm_cmpgt_epi32(xl, bxr),
+                                         _mm_cmpgt_epi32(bxl, xr)),
+                            _mm_or_si128(_mm_cmpgt_epi32(yu, byd),
+                                         _mm_cmpgt_epi32(byu, yd))) };
+        const auto lanes { _mm_movemask_ps(_mm_castsi128_ps(miss)) };
+        mask |= (~static_cast<std::uint32_t>(lanes) & 0xF) << k;
+    }
+    return n < 32 ? mask & ((std::uint32_t{ 1 } << n) - 1) : mask;
+}
+
+// a <= b as unsigned is max(a, b) == b
+__attribute__((target("avx2")))
+inline auto OverlapMaskAVX2(const BoundingBox_t& box,
+                            const AABBArrays_t& boxes,
+                            std::uint32_t dx, std::uint32_t dy,
+                            std::size_t n)
+-> std::uint32_t
+{
+    const auto bxl { _mm256_set1_epi32(static_cast<int>(box.xLeft)) };
+    const auto bxr { _mm256_set1_epi32(static_cast<int>(box.xRight)) };
+    const auto byu { _mm256_set1_epi32(static_cast<int>(box.yUp)) };
+    const auto byd { _mm256_set1_epi32(static_cast<int>(box.yDown)) };
+    const auto vdx { _mm256_set1_epi32(static_cast<int>(dx)) };
+    const auto vdy { _mm256_set1_epi32(static_cast<int>(dy)) };
+
+    std::uint32_t mask { 0 };
+    for (std::size_t k { 0 }; k < n; k += 8) {
+        const auto xl { _mm256_add_epi32(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(boxes.xLeft + k)), vdx) };
+        const auto xr { _mm256_add_epi32(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(boxes.xRight + k)), vdx) };
+        const auto yu { _mm256_add_epi32(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(boxes.yUp + k)), vdy) };
+        const auto yd { _mm256_add_epi32(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(boxes.yDown + k)), vdy) };
+        const auto hit { _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi32(_mm256_max_epu32(xl, bxr), bxr),
+                _mm256_cmpeq_epi32(_mm256_max_epu32(bxl, xr), xr)),
+            _mm256_and_si256(
+                _mm256_cmpeq_epi32(_mm256_max_epu32(yu, byd), byd),
+                _mm256_cmpeq_epi32(_mm256_max_epu32(byu, yd), yd))) };
+        const auto lanes { _mm256_movemask_ps(_mm256_castsi256_ps(hit)) };
+        mask |= static_cast<std::uint32_t>(lanes) << k;
+    }
+    return n < 32 ? mask & ((std::uint32_t{ 1 } << n) - 1) : mask;
+}
+
+#endif
+
+inline auto OverlapMask(ECS::SimdLevel_t level,
+                        const BoundingBox_t& box,
+                        const AABBArrays_t& boxes,
+                        std::uint32_t dx, std::uint32_t dy,
+                        std::size_t n)
+-> std::uint32_t
+{
+#ifdef ECS_SIMD_X86
+    switch (level) {
+        case ECS::SimdLevel_t::AVX2:
+            return OverlapMaskAVX2(box, boxes, dx, dy, n);
+        case ECS::SimdLevel_t::SSE2:
+            return OverlapMaskSSE2(box, boxes, dx, dy, n);
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    return OverlapMaskScalar(box, boxes, dx, dy, n);
+}
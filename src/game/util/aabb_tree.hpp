@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <ecs/util/helpers.hpp>
+
+#include <game/cmp/collider.hpp>
+
+// Bounding volume tree over boxes that don't move, built at once from the top
+// by splitting the boxes at the median of their centers on the longest axis.
+// It is meant to be built again only when the boxes change. A box that wraps
+// around the coordinates or is as wide or as tall as the max extent is found
+// by every query, the same as the boxes the broadphases pair with everything
+class StaticAABBTree_t
+{
+
+public:
+
+    constexpr static inline std::uint32_t LeafSize { 4 };
+
+    void Build(const std::vector<BoundingBox_t>& boxes,
+               std::uint64_t max_extent)
+    {
+        m_Nodes.clear();
+        m_Items.clear();
+        m_Always.clear();
+        for (std::uint32_t i { 0 }; i < boxes.size(); ++i) {
+            const auto& box { boxes[i] };
+            if (box.xLeft > box.xRight || box.yUp > box.yDown
+                || box.xRight - box.xLeft >= max_extent
+                || box.yDown  - box.yUp   >= max_extent) {
+                m_Always.push_back(i);
+            } else {
+                m_Items.push_back(i);
+            }
+        }
+        if (!m_Items.empty()) {
+            BuildNode(boxes, 0, static_cast<std::uint32_t>(m_Items.size()));
+        }
+        FillItemBoxes(boxes);
+    }
+
+    // Room for a tree of n boxes. The leaves hold at least LeafSize / 2
+    // items, so there are fewer nodes than boxes
+    void Reserve(std::size_t n)
+    {
+        ECS::ReserveAtLeast(m_Nodes, n);
+        ECS::ReserveAtLeast(m_Items, n);
+        ECS::ReserveAtLeast(m_ItemBoxes, n);
+        ECS::ReserveAtLeast(m_Always, n);
+    }
+
+    // Calls callable(i) for every box i that overlaps box, which must not
+    // wrap. The stack is only scratch memory, so the queries can run at the
+    // same time with their own
+    template<class Callable_t>
+    void Query(const BoundingBox_t& box,
+               std::vector<std::uint32_t>& stack,
+               Callable_t&& callable) const
+    {
+        for (const auto i : m_Always) {
+            callable(i);
+        }
+        if (m_Nodes.empty()) {
+            return;
+        }
+
+        stack.assign(1, 0);
+        while (!stack.empty()) {
+            const auto& node { m_Nodes[stack.back()] };
+            const auto index { stack.back() };
+            stack.pop_back();
+            if (!Overlap(node.box, box)) {
+                continue;
+            }
+            if (node.count) {
+                for (auto k { node.begin }; k < node.begin + node.count; ++k) {
+                    if (Overlap(m_ItemBoxes[k], box)) {
+                        callable(m_Items[k]);
+                    }
+                }
+                continue;
+            }
+            stack.push_back(index + 1);
+            stack.push_back(node.begin);
+        }
+    }
+
+private:
+
+    // A leaf has the items [begin, begin + count), an inner node has
+    // count == 0, its left child right after it and the right one at begin
+    struct Node_t
+    {
+        BoundingBox_t box   {  };
+        std::uint32_t begin {  };
+        std::uint32_t count {  };
+    };
+
+    static auto Overlap(const BoundingBox_t& a, const BoundingBox_t& b) -> bool
+    {
+        return a.xLeft <= b.xRight && b.xLeft <= a.xRight
+            && a.yUp   <= b.yDown  && b.yUp   <= a.yDown;
+    }
+
+    auto BuildNode(const std::vector<BoundingBox_t>& boxes,
+                   std::uint32_t begin, std::uint32_t end)
+    -> void
+    {
+        const auto index { static_cast<std::uint32_t>(m_Nodes.size()) };
+        m_Nodes.push_back({ boxes[m_Items[begin]], begin, end - begin });
+        auto& bounds { m_Nodes[index].box };
+        for (auto k { begin + 1 }; k < end; ++k) {
+            const auto& box { boxes[m_Items[k]] };
+            bounds = { std::min(bounds.xLeft,  box.xLeft),
+                       std::max(bounds.xRight, box.xRight),
+                       std::min(bounds.yUp,    box.yUp),
+                       std::max(bounds.yDown,  box.yDown) };
+        }
+
+        if (end - begin <= LeafSize) {
+            return;
+        }
+
+        // Twice the center, so the compares stay in integers
+        const bool by_x { bounds.xRight - bounds.xLeft
+                          >= bounds.yDown - bounds.yUp };
+        auto center {
+            [&boxes, by_x](std::uint32_t i) -> std::uint64_t {
+                const auto& box { boxes[i] };
+                return by_x ? std::uint64_t{ box.xLeft } + box.xRight
+                            : std::uint64_t{ box.yUp }   + box.yDown;
+            }
+        };
+        const auto mid { begin + (end - begin) / 2 };
+        std::nth_element(m_Items.begin() + begin, m_Items.begin() + mid,
+                         m_Items.begin() + end,
+                         [&center](std::uint32_t a, std::uint32_t b) {
+                             return center(a) < center(b);
+                         });
+
+        m_Nodes[index].count = 0;
+        BuildNode(boxes, begin, mid);
+        m_Nodes[index].begin = static_cast<std::uint32_t>(m_Nodes.size());
+        BuildNode(boxes, mid, end);
+    }
+
+    // The boxes of the items in the order of the leaves, so a leaf reads
+    // them side by side
+    auto FillItemBoxes(const std::vector<BoundingBox_t>& boxes) -> void
+    {
+        m_ItemBoxes.resize(m_Items.size());
+        for (std::size_t k { 0 }; k < m_Items.size(); ++k) {
+            m_ItemBoxes[k] = boxes[m_Items[k]];
+        }
+    }
+
+    std::vector<Node_t>        m_Nodes     {  };
+    std::vector<std::uint32_t> m_Items     {  };
+    std::vector<BoundingBox_t> m_ItemBoxes {  };
+    std::vector<std::uint32_t> m_Always    {  };
+};
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <ecs/util/helpers.hpp>
+
+#include <game/cmp/collider.hpp>
+
+// A pair of colliders that may touch, first < second are indexes into the
+// boxes given to the broadphase
+using ColliderPair_t = std::pair<std::uint32_t, std::uint32_t>;
+
+// What the broadphases share: a box as wide or as tall as the max extent is
+// paired with every other box, and the pairs come out sorted by their first
+// index, each pair once
+class BroadphaseBase_t
+{
+
+public:
+
+    explicit BroadphaseBase_t(std::uint64_t max_extent)
+    : m_MaxExtent { std::max(max_extent, std::uint64_t{ 1 }) } {  }
+
+    auto GetMaxExtent() const -> std::uint64_t { return m_MaxExtent; }
+
+    auto GetPairs() const -> const std::vector<ColliderPair_t>&
+    {
+        return m_Pairs;
+    }
+
+    // Room for n boxes and a pair for each, more pairs than that can still
+    // grow the arrays
+    void Reserve(std::size_t n)
+    {
+        ECS::ReserveAtLeast(m_Overflow, n);
+        ECS::ReserveAtLeast(m_IsOverflow, n);
+        ECS::ReserveAtLeast(m_Pairs, n);
+        ECS::ReserveAtLeast(m_SortedPairs, n);
+        ECS::ReserveAtLeast(m_PairBegin, n + 1);
+    }
+
+    // A box that wraps around the unsigned coordinates, left > right, only
+    // overlaps the boxes that cover the gap [right, left]. When the gap is
+    // as wide as the max extent only the boxes paired with everything can
+    // do that, so the box doesn't need pairs of its own
+    auto PairsOnlyWithOverflow(const BoundingBox_t& box) const -> bool
+    {
+        return (box.xLeft > box.xRight
+                && box.xLeft - box.xRight >= m_MaxExtent)
+            || (box.yUp > box.yDown
+                && box.yUp - box.yDown >= m_MaxExtent);
+    }
+
+protected:
+
+    static auto Wraps(const BoundingBox_t& box) -> bool
+    {
+        return box.xLeft > box.xRight || box.yUp > box.yDown;
+    }
+
+    auto IsOversized(const BoundingBox_t& box) const -> bool
+    {
+        return box.xRight - box.xLeft >= m_MaxExtent
+            || box.yDown  - box.yUp   >= m_MaxExtent;
+    }
+
+    void PairOverflow(std::size_t n_boxes)
+    {
+        m_IsOverflow.assign(n_boxes, false);
+        for (const auto o : m_Overflow) {
+            m_IsOverflow[o] = true;
+        }
+        for (const auto o : m_Overflow) {
+            for (std::uint32_t i { 0 }; i < n_boxes; ++i) {
+                if (i != o && (!m_IsOverflow[i] || o < i)) {
+                    m_Pairs.push_back({ std::min(o, i), std::max(o, i) });
+                }
+            }
+        }
+    }
+
+    // Counting sort by the first index, the order of the second ones
+    // doesn't matter
+    void SortPairsByFirst(std::size_t n_boxes)
+    {
+        m_PairBegin.assign(n_boxes + 1, 0);
+        for (const auto& pair : m_Pairs) {
+            ++m_PairBegin[pair.first + 1];
+        }
+        for (std::size_t i { 1 }; i < m_PairBegin.size(); ++i) {
+            m_PairBegin[i] += m_PairBegin[i - 1];
+        }
+        m_SortedPairs.resize(m_Pairs.size());
+        for (const auto& pair : m_Pairs) {
+            m_SortedPairs[m_PairBegin[pair.first]++] = pair;
+        }
+        m_Pairs.swap(m_SortedPairs);
+    }
+
+    std::uint64_t m_MaxExtent {  };
+
+    std::vector<std::uint32_t>  m_Overflow    {  };
+    std::vector<bool>           m_IsOverflow  {  };
+    std::vector<ColliderPair_t> m_Pairs       {  };
+    std::vector<ColliderPair_t> m_SortedPairs {  };
+    std::vector<std::uint32_t>  m_PairBegin   {  };
+};
+
+// Uniform grid of square cells hashed into a table rebuilt every frame. Every
+// box goes to the cells it covers and only the boxes that share a cell become
+// a pair. A box that covers more than MaxCellsPerBox cells is paired with
+// every other box instead
+class SpatialHashGrid_t : public BroadphaseBase_t
+{
+
+public:
+
+    constexpr static inline std::uint64_t MaxCellsPerBox { 64 };
+
+    // Any box as wide as MaxCellsPerBox cells covers more than that
+    explicit SpatialHashGrid_t(unsigned cell_size = 64)
+    : BroadphaseBase_t { MaxCellsPerBox * std::max(cell_size, 1u) },
+      m_CellSize { std::max(cell_size, 1u) } {  }
+
+    void SetCellSize(unsigned cell_size)
+    {
+        m_CellSize  = std::max(cell_size, 1u);
+        m_MaxExtent = MaxCellsPerBox * m_CellSize;
+    }
+
+    auto GetCellSize() const -> unsigned { return m_CellSize; }
+
+    // Room for n boxes of up to a cell each, which cover 4 cells at most
+    void Reserve(std::size_t n)
+    {
+        BroadphaseBase_t::Reserve(n);
+        const auto n_buckets { std::size_t{ 1 } << BucketBits(4 * n) };
+        ECS::ReserveAtLeast(m_FirstCell, n);
+        ECS::ReserveAtLeast(m_Entries, 4 * n);
+        ECS::ReserveAtLeast(m_Sorted, 4 * n);
+        ECS::ReserveAtLeast(m_BucketBegin, n_buckets + 1);
+        ECS::ReserveAtLeast(m_Cursor, n_buckets);
+    }
+
+    void Build(const std::vector<BoundingBox_t>& boxes)
+    {
+        m_Pairs.clear();
+        m_Entries.clear();
+        m_Overflow.clear();
+        m_FirstCell.resize(boxes.size());
+
+        for (std::uint32_t i { 0 }; i < boxes.size(); ++i) {
+            InsertBox(i, boxes[i]);
+        }
+
+        FillBuckets();
+        for (std::size_t b { 0 }; b + 1 < m_BucketBegin.size(); ++b) {
+            PairBucket(m_BucketBegin[b], m_BucketBegin[b + 1]);
+        }
+        PairOverflow(boxes.size());
+        SortPairsByFirst(boxes.size());
+    }
+
+private:
+
+    struct Cell_t
+    {
+        std::uint32_t x {  };
+        std::uint32_t y {  };
+
+        constexpr auto operator==(const Cell_t& other) const -> bool
+        {
+            return x == other.x && y == other.y;
+        }
+    };
+
+    struct Entry_t
+    {
+        Cell_t        cell   {  };
+        std::uint32_t box    {  };
+        std::uint32_t bucket {  };
+    };
+
+    void InsertBox(std::uint32_t i, const BoundingBox_t& box)
+    {
+        if (Wraps(box)) {
+            if (!PairsOnlyWithOverflow(box)) {
+                m_Overflow.push_back(i);
+            }
+            return;
+        }
+
+        const Cell_t first { box.xLeft / m_CellSize, box.yUp / m_CellSize };
+        const Cell_t last  { box.xRight / m_CellSize, box.yDown / m_CellSize };
+        const auto n_cols { std::uint64_t{ last.x } - first.x + 1 };
+        const auto n_rows { std::uint64_t{ last.y } - first.y + 1 };
+        if (n_cols > MaxCellsPerBox || n_rows > MaxCellsPerBox
+            || n_cols * n_rows > MaxCellsPerBox) {
+            m_Overflow.push_back(i);
+            return;
+        }
+
+        m_FirstCell[i] = first;
+        for (auto y { first.y }; ; ++y) {
+            for (auto x { first.x }; ; ++x) {
+                m_Entries.push_back({ { x, y }, i, 0 });
+                if (x == last.x) break;
+            }
+            if (y == last.y) break;
+        }
+    }
+
+    // The table has at least twice as many buckets as entries
+    static auto BucketBits(std::size_t n_entries) -> unsigned
+    {
+        unsigned bits { 1 };
+        while ((std::size_t{ 1 } << bits) < 2 * n_entries) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    // Counting sort of the entries by the bucket of their cell
+    void FillBuckets()
+    {
+        const auto bits { BucketBits(m_Entries.size()) };
+        m_BucketBegin.assign((std::size_t{ 1 } << bits) + 1, 0);
+
+        for (auto& entry : m_Entries) {
+            const auto key
+            {
+                (std::uint64_t{ entry.cell.x } << 32) | entry.cell.y
+            };
+            entry.bucket = static_cast<std::uint32_t>(
+                    (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+            ++m_BucketBegin[entry.bucket + 1];
+        }
+        for (std::size_t b { 1 }; b < m_BucketBegin.size(); ++b) {
+            m_BucketBegin[b] += m_BucketBegin[b - 1];
+        }
+
+        m_Sorted.resize(m_Entries.size());
+        m_Cursor.assign(m_BucketBegin.begin(), m_BucketBegin.end() - 1);
+        for (const auto& entry : m_Entries) {
+            m_Sorted[m_Cursor[entry.bucket]++] = entry;
+        }
+    }
+
+    // Two boxes share a block of cells, the pair comes out only from the
+    // cell at the top left corner of that block
+    void PairBucket(std::uint32_t begin, std::uint32_t end)
+    {
+        for (auto a { begin }; a < end; ++a) {
+            const auto& ea { m_Sorted[a] };
+            for (auto b { a + 1 }; b < end; ++b) {
+                const auto& eb { m_Sorted[b] };
+                if (!(ea.cell == eb.cell)) {
+                    continue;
+                }
+                const auto& fa { m_FirstCell[ea.box] };
+                const auto& fb { m_FirstCell[eb.box] };
+                const Cell_t corner
+                {
+                    std::max(fa.x, fb.x), std::max(fa.y, fb.y)
+                };
+                if (corner == ea.cell) {
+                    m_Pairs.push_back({ std::min(ea.box, eb.box),
+                                        std::max(ea.box, eb.box) });
+                }
+            }
+        }
+    }
+
+    unsigned m_CellSize {  };
+
+    std::vector<Entry_t>       m_Entries     {  };
+    std::vector<Entry_t>       m_Sorted      {  };
+    std::vector<Cell_t>        m_FirstCell   {  };
+    std::vector<std::uint32_t> m_BucketBegin {  };
+    std::vector<std::uint32_t> m_Cursor      {  };
+};
+
+// Sweep and prune on the x axis. The boxes are kept sorted by their left
+// side between frames and re-sorted with an insertion sort, which is close
+// to linear when they only move a few pixels. A box is identified by its
+// index, so a box that changes index costs a few more swaps but the order
+// stays right. When many boxes are new there is no order to keep and they
+// are sorted from scratch
+class SweepAndPrune_t : public BroadphaseBase_t
+{
+
+public:
+
+    explicit SweepAndPrune_t(std::uint64_t max_extent = 4096)
+    : BroadphaseBase_t { max_extent } {  }
+
+    void Build(const std::vector<BoundingBox_t>& boxes)
+    {
+        m_Pairs.clear();
+        m_Overflow.clear();
+
+        const auto n_boxes { static_cast<std::uint32_t>(boxes.size()) };
+        m_Order.erase(std::remove_if(m_Order.begin(), m_Order.end(),
+                                     [n_boxes](std::uint32_t i) {
+                                         return i >= n_boxes;
+                                     }),
+                      m_Order.end());
+        const auto n_kept { m_Order.size() };
+        for (auto i { static_cast<std::uint32_t>(n_kept) };
+             i < n_boxes; ++i) {
+            m_Order.push_back(i);
+        }
+
+        if (m_Order.size() - n_kept > n_kept / 16) {
+            std::sort(m_Order.begin(), m_Order.end(),
+                      [&boxes](std::uint32_t a, std::uint32_t b) {
+                          return boxes[a].xLeft < boxes[b].xLeft;
+                      });
+        } else {
+            InsertionSort(boxes);
+        }
+        Sweep(boxes);
+        PairOverflow(boxes.size());
+        SortPairsByFirst(boxes.size());
+    }
+
+    void Reserve(std::size_t n)
+    {
+        BroadphaseBase_t::Reserve(n);
+        ECS::ReserveAtLeast(m_Order, n);
+    }
+
+private:
+
+    void InsertionSort(const std::vector<BoundingBox_t>& boxes)
+    {
+        for (std::size_t i { 1 }; i < m_Order.size(); ++i) {
+            const auto idx  { m_Order[i] };
+            const auto left { boxes[idx].xLeft };
+            auto j { i };
+            for (; j > 0 && boxes[m_Order[j - 1]].xLeft > left; --j) {
+                m_Order[j] = m_Order[j - 1];
+            }
+            m_Order[j] = idx;
+        }
+    }
+
+    // The boxes after a in the order whose left side is inside a, only the
+    // ones that also overlap a on the y axis become a pair
+    void Sweep(const std::vector<BoundingBox_t>& boxes)
+    {
+        for (std::size_t a { 0 }; a < m_Order.size(); ++a) {
+            const auto ia { m_Order[a] };
+            const auto& ba { boxes[ia] };
+            if (Wraps(ba)) {
+                if (!PairsOnlyWithOverflow(ba)) {
+                    m_Overflow.push_back(ia);
+                }
+                continue;
+            }
+            if (IsOversized(ba)) {
+                m_Overflow.push_back(ia);
+                continue;
+            }
+
+            for (auto b { a + 1 }; b < m_Order.size(); ++b) {
+                const auto ib { m_Order[b] };
+                const auto& bb { boxes[ib] };
+                if (bb.xLeft > ba.xRight) {
+                    break;
+                }
+                if (Wraps(bb) || IsOversized(bb)
+                    || bb.yUp > ba.yDown || ba.yUp > bb.yDown) {
+                    continue;
+                }
+                m_Pairs.push_back({ std::min(ia, ib), std::max(ia, ib) });
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> m_Order {  };
+};
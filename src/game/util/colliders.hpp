@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <game/cmp/collider.hpp>
+
+// Collider shapes of the game, kept apart from the factory so they can be
+// used without raylib
+
+constexpr auto
+BoxFromSize(int xLeft, int xRight, int yUp, int yDown, float sz)
+-> BoundingBox_t
+{
+    return { static_cast<unsigned>(xLeft / sz),
+             static_cast<unsigned>(xRight / sz),
+             static_cast<unsigned>(yUp / sz),
+             static_cast<unsigned>(yDown / sz) };
+}
+
+// The boxes under the root box of the player sprite, drawn at 1 / sz
+inline auto PlayerBoxNodes(float sz)
+-> std::vector<BoundingBoxNode_t>
+{
+    return { {
+               {
+                   { {}, BoxFromSize(140, 355, 20 , 90, sz) },
+                   { {}, BoxFromSize(102, 354, 103,238, sz) }
+               },
+               { BoxFromSize(86 , 366, 13 , 250, sz) }
+             },
+             { {}, { BoxFromSize(6  , 89 , 260, 428, sz) } },
+             { {}, { BoxFromSize(96 , 302, 266, 380, sz) } },
+             { {}, { BoxFromSize(66 , 395, 394, 546, sz) } },
+             { {}, { BoxFromSize(317, 476, 267, 408, sz) } },
+             {
+                 {
+                   { {}, BoxFromSize(423, 545, 225, 343, sz) },
+                   { {}, BoxFromSize(557, 600, 245, 326, sz) },
+                   { {}, BoxFromSize(611, 673, 247, 303, sz) },
+                 },
+                 { BoxFromSize(406, 686, 209, 355, sz) }
+             } };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <ecs/cmp/entity.hpp>
+
+// Resource for the access list of the systems that use the contacts of the
+// frame, the collider system writes them and the others only read
+struct ContactResource_t {  };
+
+// Two leaves of the collider trees of two entities that touch, the leaves
+// are node indexes of their BoundingBoxTree_t
+struct Contact_t
+{
+    ECS::EntityHandle_t entityA {  };
+    ECS::EntityHandle_t entityB {  };
+    std::uint32_t       leafA   {  };
+    std::uint32_t       leafB   {  };
+};
+
+// For the narrowphase calls that only want the collided flags
+struct IgnoreContact_t
+{
+    constexpr void operator()(std::uint32_t, std::uint32_t) const {  }
+};
+
+// The contacts of the last collider update. The vectors are cleared every
+// frame but keep their memory. The contacts and the entities in touched come
+// in the same order whatever the broadphase, every entity with at least one
+// contact is in touched once
+struct ContactBuffer_t
+{
+    void Clear()
+    {
+        contacts.clear();
+        touched.clear();
+    }
+
+    std::vector<Contact_t>           contacts {  };
+    std::vector<ECS::EntityHandle_t> touched  {  };
+};
@@ -1,7 +1,5 @@
 #pragma once
 
-#include "raylib.h"
-
 #include <ecs/util/helpers.hpp>
 
 #include <game/sys/collider.hpp>
@@ -10,47 +8,46 @@
 #include <game/sys/render.hpp>
 #include <game/sys/spawn.hpp>
 #include <game/sys/health.hpp>
+#include <game/sys/sleep.hpp>
+
+#include <game/util/colliders.hpp>
 
-template<class EntityManager_t>
+// The textures and the random positions come from the platform backend,
+// see game/platform. The textures are loaded here, on the thread that owns
+// the window, not by the first entity that needs them
+template<class EntityManager_t, class Platform_t>
 struct GameFactory_t
 {
-    constexpr
-    GameFactory_t(EntityManager_t& ent_man) : m_EntMan { ent_man } {  }
+    GameFactory_t(EntityManager_t& ent_man, Platform_t& platform)
+        : m_EntMan   { ent_man },
+          m_Platform { platform },
+          m_Blade    { platform.LoadTexture("assets/blade.png") },
+          m_Ground   { platform.LoadTexture("assets/platform.png") },
+          m_Player   { platform.LoadTexture("assets/sprite.png") } {  }
 
     constexpr auto
-    CreateEntity(Texture2D& sp, int px, int py, float sz = 5.0f)
+    CreateEntity(const Texture_t& sp, int px, int py, float sz = 5.0f)
     -> decltype(auto)
     {
-        auto& ent { m_EntMan.CreateEntity() };
-
-        auto ren_args { ECS::MakeArgs(sp, sz) };
-        auto phy_args { ECS::MakeArgs(VecInt{ px, py }, VecInt{ 5, 7 }) };
-        auto col_args { ECS::MakeArgs(  ) };
-        auto hel_args { ECS::MakeArgs(50u) };
-
-        auto [ren, phy, col, hel]
-        {
-            m_EntMan.template
-            CreateRequieredComponents<RenderComponent_t,
-                                      PhysicsComponent_t,
-                                      ColliderComponent_t,
-                                      HealthComponent_t>
-            (ent, ren_args, phy_args, col_args, hel_args)
-        };
+        return BuildEntity(m_EntMan, sp, px, py, sz);
+    }
 
-        col.BoxRoot.box.xRight = ren.wh.x;
-        col.BoxRoot.box.xLeft  = 0;
-        col.BoxRoot.box.yUp    = 0;
-        col.BoxRoot.box.yDown  = ren.wh.y;
-        return ent;
+    // Same as CreateEntity but recorded in the command buffer of the manager,
+    // it is safe to call while the systems are iterating the pools
+    auto
+    DeferEntity(const Texture_t& sp, int px, int py, float sz = 5.0f,
+                std::uint8_t mask = ColliderComponent_t::LALL)
+    -> ECS::DeferredEntity_t
+    {
+        return BuildEntity(m_EntMan.GetCommandBuffer(), sp, px, py, sz, mask);
     }
 
     constexpr auto
-    CreateRandomEntity(Texture2D& sp, int wh, int hg, float sz = 5.0f)
+    CreateRandomEntity(const Texture_t& sp, int wh, int hg, float sz = 5.0f)
     -> decltype(auto)
     {
-        const int x = GetRandomValue(0, wh - sp.width / sz);
-        const int y = GetRandomValue(0, hg - sp.height / sz);
+        const int x = m_Platform.GetRandomValue(0, wh - sp.width / sz);
+        const int y = m_Platform.GetRandomValue(0, hg - sp.height / sz);
         auto& e = CreateEntity(sp, x, y, sz);
         return e;
     }
@@ -75,14 +72,14 @@ struct GameFactory_t
             (ent, phy_args, spw_args, col_args)
         };
         col.mask = ColliderComponent_t::LNONE;
+        col.BoxTree.Build(col.BoxRoot);
 
         return ent;
     }
 
     decltype(auto) CreateBlade(int px, int py)
     {
-        static Texture2D blade  { LoadTexture("assets/blade.png") };
-        auto& ent { CreateEntity(blade, px, py, 7.0f) };
+        auto& ent { CreateEntity(m_Blade, px, py, 7.0f) };
         auto& col
         {
             m_EntMan.template
@@ -92,10 +89,14 @@ struct GameFactory_t
         return ent;
     }
 
+    auto DeferBlade(int px, int py) -> ECS::DeferredEntity_t
+    {
+        return DeferEntity(m_Blade, px, py, 7.0f, ColliderComponent_t::LBLADES);
+    }
+
     decltype(auto) CreateRandomBlade(int wh, int hg)
     {
-        static Texture2D blade  { LoadTexture("assets/blade.png") };
-        auto& ent { CreateRandomEntity(blade, wh, hg, 7.0f) };
+        auto& ent { CreateRandomEntity(m_Blade, wh, hg, 7.0f) };
         auto& col
         {
             m_EntMan.template
@@ -107,11 +108,9 @@ struct GameFactory_t
 
     decltype(auto) CreatePlatform(int x, int y, float sz = 1.0f)
     {
-        static Texture2D platform { LoadTexture("assets/platform.png") };
-
         auto& ent { m_EntMan.CreateEntity() };
 
-        auto ren_args { ECS::MakeArgs(platform, sz) };
+        auto ren_args { ECS::MakeArgs(m_Ground, sz) };
         auto phy_args { ECS::MakeArgs(VecInt{x, y}, VecInt{  }) };
         auto col_args { ECS::MakeArgs() };
         auto [ren, phy, col]
@@ -123,19 +122,20 @@ struct GameFactory_t
             (ent, ren_args, phy_args, col_args)
         };
         col.mask = ColliderComponent_t::LPLATFORM;
+        col.is_static = true;
 
         col.BoxRoot.box.xRight = ren.wh.x;
         col.BoxRoot.box.xLeft  = 0;
         col.BoxRoot.box.yUp    = 0;
         col.BoxRoot.box.yDown  = ren.wh.y;
+        col.BoxTree.Build(col.BoxRoot);
 
         return ent;
     }
 
     decltype(auto) CreatePlayer(int wh, int hg, float sz = 5.0f)
     {
-        static Texture2D player { LoadTexture("assets/sprite.png") };
-        auto& ent { CreateRandomEntity(player, wh, hg, sz) };
+        auto& ent { CreateRandomEntity(m_Player, wh, hg, sz) };
 
         m_EntMan.template CreateRequieredComponent<InputComponent_t>(ent);
 
@@ -154,39 +154,50 @@ struct GameFactory_t
         hel.health = 255u;
 
         col.mask = ColliderComponent_t::LALL;
-        col.BoxRoot.root = { {
-                               {
-                                   { {}, BoxFromSize(140, 355, 20 , 90, sz) },
-                                   { {}, BoxFromSize(102, 354, 103,238, sz) }
-                               },
-                               { BoxFromSize(86 , 366, 13 , 250, sz) }
-                             },
-                             { {}, { BoxFromSize(6  , 89 , 260, 428, sz) } },
-                             { {}, { BoxFromSize(96 , 302, 266, 380, sz) } },
-                             { {}, { BoxFromSize(66 , 395, 394, 546, sz) } },
-                             { {}, { BoxFromSize(317, 476, 267, 408, sz) } },
-                             {
-                                 {
-                                   { {}, BoxFromSize(423, 545, 225, 343, sz) },
-                                   { {}, BoxFromSize(557, 600, 245, 326, sz) },
-                                   { {}, BoxFromSize(611, 673, 247, 303, sz) },
-                                 },
-                                 { BoxFromSize(406, 686, 209, 355, sz) }
-                             } };
+        col.BoxRoot.root = PlayerBoxNodes(sz);
+        col.BoxTree.Build(col.BoxRoot);
 
         return ent;
     }
 
-    constexpr auto
-    BoxFromSize(int xLeft, int xRight, int yUp, int yDown, float sz)
-    -> BoundingBox_t
+private:
+    // Target_t is the manager, the entity is made now, or its command
+    // buffer, the entity is made at the next flush
+    template<class Target_t>
+    auto
+    BuildEntity(Target_t& target, const Texture_t& sp, int px, int py,
+                float sz, std::uint8_t mask = ColliderComponent_t::LALL)
+    -> decltype(target.CreateEntity())
     {
-        return { static_cast<unsigned>(xLeft / sz),
-                 static_cast<unsigned>(xRight / sz),
-                 static_cast<unsigned>(yUp / sz),
-                 static_cast<unsigned>(yDown / sz) };
+        auto&& ent { target.CreateEntity() };
+
+        auto ren_args { ECS::MakeArgs(sp, sz) };
+        auto phy_args { ECS::MakeArgs(VecInt{ px, py }, VecInt{ 5, 7 }) };
+        auto col_args { ECS::MakeArgs(  ) };
+        auto hel_args { ECS::MakeArgs(50u) };
+
+        auto [ren, phy, col, hel]
+        {
+            target.template
+            CreateRequieredComponents<RenderComponent_t,
+                                      PhysicsComponent_t,
+                                      ColliderComponent_t,
+                                      HealthComponent_t>
+            (ent, ren_args, phy_args, col_args, hel_args)
+        };
+
+        col.BoxRoot.box.xRight = ren.wh.x;
+        col.BoxRoot.box.xLeft  = 0;
+        col.BoxRoot.box.yUp    = 0;
+        col.BoxRoot.box.yDown  = ren.wh.y;
+        col.BoxTree.Build(col.BoxRoot);
+        col.mask = mask;
+        return ent;
     }
 
-private:
-    EntityManager_t& m_EntMan {  };
+    EntityManager_t& m_EntMan   {  };
+    Platform_t&      m_Platform {  };
+    Texture_t        m_Blade    {  };
+    Texture_t        m_Ground   {  };
+    Texture_t        m_Player   {  };
 };
@@ -1,11 +1,29 @@
-#include <raylib.h>
-
 #include <ecs/man/entity_manager.hpp>
+#include <ecs/util/alloc_tracker_new.hpp>
 
 #include <game/util/gamefactory.hpp>
 
-int main()
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef GAME_HEADLESS
+#include <game/platform/null.hpp>
+#else
+#include <game/platform/raylib.hpp>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
 {
+#ifdef GAME_HEADLESS
+    // Without a window the game runs for the frames given, 600 by default
+    NullPlatform_t platform
+    {
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 600
+    };
+#else
+    RaylibPlatform_t platform {  };
+#endif
+
     ECS::EntityManager_t<PhysicsComponent_t,
                          RenderComponent_t,
                          InputComponent_t,
@@ -14,33 +32,75 @@ int main()
                          SpawnComponent_t> ent_man {  };
 
     const
-    RenderSystem_t   ren_sys { 640, 480, "Game"  };
+    RenderSystem_t   ren_sys { platform, 640, 480, "Game" };
     PhysicsSystem_t  phy_sys {  };
-    InputSystem_t    inp_sys {  };
+    InputSystem_t    inp_sys { platform };
     ColliderSystem_t col_sys { 640, 480 };
-    HealthSystem_t   hel_sys {  };
+    HealthSystem_t   hel_sys { col_sys.GetContacts() };
     SpawnSystem_t    spw_sys {  };
+    SleepSystem_t    slp_sys { col_sys.GetContacts() };
 
     ren_sys.ToggleDebugRender();
 
-    GameFactory_t go_fact { ent_man };
+    GameFactory_t go_fact { ent_man, platform };
 
     go_fact.CreateSpawner(50, 50,
             [&go_fact](int x, int y) {
-                    go_fact.CreateBlade(x, y);
+                    go_fact.DeferBlade(x, y);
             });
     go_fact.CreateRandomBlade(640, 480);
     go_fact.CreateRandomBlade(640, 480);
     go_fact.CreatePlatform(500, 400);
     go_fact.CreatePlayer(640, 480);
 
-    while (ren_sys.Update(ent_man)) {
-        spw_sys.Update(ent_man);
-        phy_sys.Update(ent_man);
-        col_sys.Update(ent_man);
-        hel_sys.Update(ent_man);
-        inp_sys.Update(ent_man);
+    // The rendering stays on the main thread, the rest of the systems run
+    // on the pool as soon as the systems they depend on are done. Each one
+    // records into a command buffer of its own, so the health and the input
+    // systems share the level after the collider
+    ECS::SystemScheduler_t sys_sched { spw_sys,
+                                       phy_sys,
+                                       col_sys,
+                                       hel_sys,
+                                       inp_sys,
+                                       slp_sys };
+    static_assert(decltype(sys_sched)::Plan.level_count == 5,
+                  "Spawn, physics, collider, health and input, sleep");
+
+    // The second argument prints the memory of the manager every that many
+    // frames, see ecs/man/memory_report.hpp
+    ECS::MemorySummary_t mem_sum
+    {
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0
+    };
+
+    // After the first frames the pools, the command buffer and the buffers
+    // of the systems have their room, the frames that follow must not
+    // allocate, see ecs/util/alloc_tracker.hpp
+    [[maybe_unused]] constexpr std::uint64_t warm_up_frames { 2 };
+
+    for (std::uint64_t frame { 0 }; ren_sys.Update(ent_man); ++frame) {
+        ECS_PROFILE_SCOPE("Frame");
+        {
+            ECS_ALLOC_STEADY_SCOPE("Frame", frame >= warm_up_frames);
+            sys_sched.Update(ent_man);
+            ent_man.FlushCommandBuffer();
+        }
+        mem_sum.Update(ent_man);
+#ifdef ECS_ALLOC_TRACKING
+        ECS::AllocTracker_t::Get().EndFrame();
+#endif
     }
 
+#ifdef ECS_PROFILE
+    // The last frames of every thread, see ecs/util/profiler.hpp
+    ECS::Profiler_t::Get().WriteChromeTrace("profile.json");
+#endif
+#ifdef ECS_PERF_COUNTERS
+    ECS::PerfCounters_t::Get().Report();
+#endif
+#ifdef ECS_ALLOC_TRACKING
+    ECS::AllocTracker_t::Get().Report();
+#endif
+
     return 0;
 }